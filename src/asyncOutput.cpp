@@ -0,0 +1,213 @@
+#include "asyncOutput.h"
+#include "latticeArena.h"   // strideX, strideY
+
+/**
+Asynchronous, double-buffered snapshot output
+
+Writing a frame stalls every rank for the latency of the file system. With
+the output thread, the solver only copies the field into an output buffer
+and carries on; the thread writes the buffer while the next steps are being
+computed. Two buffers are used, so a frame can be handed over while the
+previous one is still being written, and the solver only blocks when both
+are busy.
+
+Only the interior nodes are copied: the ghost layers of the field may still
+be filled by a halo exchange on the communication thread, and the writers
+only read the interior anyway.
+
+The per-rank output does not call MPI, so any thread support level will do.
+The shared-file output writes collectively with MPI-IO from the thread,
+which needs MPI_THREAD_MULTIPLE; without it frames are written by the solver
+as before. The thread then runs its collectives on a duplicate of the
+Cartesian communicator, since the solver keeps issuing collectives of its
+own (tuner reductions, checkpoints) on the original while a frame is being
+written, and MPI forbids concurrent collectives on one communicator.
+*/
+
+// main loop of the output thread
+
+static void outputThreadLoop(output_thread * out)
+{
+    std::unique_lock<std::mutex> lock(out->mutex);
+
+    while(true)
+    {
+        out->wake.wait(lock, [out]{ return out->stop || !out->frames.empty(); });
+
+        if(out->frames.empty()) break;   // stop was requested and the queue is drained
+
+        output_frame frame = out->frames.front();
+        out->frames.pop_front();
+
+        lock.unlock();
+        double t_beg = MPI_Wtime();
+        out->writer(frame.time, out->buffer[frame.buffer].data(), out->comm);
+        double t_write = MPI_Wtime() - t_beg;
+        lock.lock();
+
+        out->write_time += t_write;
+        out->written++;
+        out->last_time = frame.time;
+        out->in_use[frame.buffer] = false;
+        out->done.notify_all();
+    }
+}
+
+// start the output thread (if requested and supported by the MPI library)
+
+void outputThreadStart(output_thread & out,
+                       const bool      enable,            // user wants asynchronous output
+                       const bool      writer_uses_mpi,   // frames are written with collective MPI-IO
+                       const int       thread_provided,   // thread support level returned by MPI_Init_thread
+                       const int       nn,                // ghost layers of the field
+                       const int       LX,                // interior nodes of the field along X
+                       const int       LY,                // interior nodes of the field along Y
+                       const int       LZ,                // interior nodes of the field along Z
+                       const frame_writer & writer,
+                       const int       myid,
+                       const MPI_Comm  CART_COMM)
+{
+    out.active     = false;
+    out.stop       = false;
+    out.nn         = nn;
+    out.LX         = LX;
+    out.LY         = LY;
+    out.LZ         = LZ;
+    out.SX         = strideX(nn, LX);
+    out.SY         = strideY(nn, LX, LY);
+    out.writer     = writer;
+    out.comm       = CART_COMM;
+    out.own_comm   = false;
+    out.written    = 0;
+    out.last_time  = -1;
+    out.write_time = 0.;
+    out.copy_time  = 0.;
+    out.wait_time  = 0.;
+
+    if(!enable) return;
+
+    if(writer_uses_mpi && thread_provided < MPI_THREAD_MULTIPLE)
+    {
+        if(myid == 0) std::cout << "WARNING: MPI library does not support MPI_THREAD_MULTIPLE, "
+                                << "shared output files are written by the solver" << std::endl;
+        return;
+    }
+
+    for(int b = 0; b < 2; b++)
+    {
+        out.buffer[b].assign(out.SX * out.SY * (nn+LZ+nn), 0.);
+        out.in_use[b] = false;
+    }
+
+    if(writer_uses_mpi)
+    {
+        MPI_Comm_dup(CART_COMM, &out.comm);
+        out.own_comm = true;
+    }
+
+    out.active = true;
+    out.worker = std::thread(outputThreadLoop, &out);
+}
+
+// write "field" as the frame of lattice time "time" (copied, so the solver may overwrite it right away)
+
+void outputThreadWrite(output_thread & out, const int time, const double* field)
+{
+    if(!out.active)
+    {
+        double t_beg = MPI_Wtime();
+        out.writer(time, field, out.comm);
+        double t_write = MPI_Wtime() - t_beg;
+        out.write_time += t_write;
+        out.wait_time  += t_write;   // nothing is hidden when the solver does the work
+        out.written++;
+        out.last_time = time;
+        return;
+    }
+
+    // wait for a free buffer (only if the previous two frames are still in the queue)
+
+    double t_beg = MPI_Wtime();
+    std::unique_lock<std::mutex> lock(out.mutex);
+    out.done.wait(lock, [&out]{ return !out.in_use[0] || !out.in_use[1]; });
+    int b = out.in_use[0] ? 1 : 0;
+    out.in_use[b] = true;
+    lock.unlock();
+    double t_free = MPI_Wtime();
+    out.wait_time += t_free - t_beg;
+
+    // interior rows only (the ghost layers of the buffer stay zero)
+    double *buffer = out.buffer[b].data();
+    for(int k = out.nn; k < out.nn + out.LZ; k++)
+    {
+        for(int j = out.nn; j < out.nn + out.LY; j++)
+        {
+            const long long row = out.nn + out.SX * (j + out.SY * k);
+            memcpy(buffer + row, field + row, out.LX * sizeof(double));
+        }
+    }
+    out.copy_time += MPI_Wtime() - t_free;
+
+    lock.lock();
+    output_frame frame = {time, b};
+    out.frames.push_back(frame);
+    out.wake.notify_one();
+}
+
+// lattice time of the last frame whose files are complete on this rank (-1: none yet)
+
+int outputThreadWritten(output_thread & out)
+{
+    if(!out.active) return out.last_time;
+
+    std::lock_guard<std::mutex> lock(out.mutex);
+    return out.last_time;
+}
+
+// write the remaining frames and join the output thread
+
+void outputThreadStop(output_thread & out)
+{
+    if(!out.active) return;
+
+    double t_beg = MPI_Wtime();
+    {
+        std::lock_guard<std::mutex> lock(out.mutex);
+        out.stop = true;
+        out.wake.notify_one();
+    }
+    out.worker.join();
+    out.wait_time += MPI_Wtime() - t_beg;   // frames still being written at the end are exposed
+    out.active = false;
+
+    if(out.own_comm)
+    {
+        MPI_Comm_free(&out.comm);
+        out.own_comm = false;
+    }
+}
+
+// print how much of the output time was hidden behind computation
+
+void outputThreadReport(const output_thread & out,
+                        const bool            enable,
+                        const int             myid,
+                        const MPI_Comm        CART_COMM)
+{
+    double local_times[3] = {out.write_time, out.copy_time, out.wait_time};
+    double max_times[3];
+    MPI_Reduce(local_times, max_times, 3, MPI_DOUBLE, MPI_MAX, 0, CART_COMM);
+
+    if(myid == 0)
+    {
+        double exposed = max_times[1] + max_times[2];
+        double hidden  = max_times[0] - max_times[2];
+        if(hidden < 0.) hidden = 0.;
+        std::cout << std::endl;
+        std::cout << "asynchronous output     : " << (enable ? "on" : "off") << " (" << out.written << " frames)" << std::endl;
+        std::cout << "frame write time        : " << max_times[0] << " s (slowest rank)" << std::endl;
+        std::cout << "exposed (copy + waits)  : " << exposed << " s (copy " << max_times[1] << " s)" << std::endl;
+        std::cout << "hidden behind compute   : " << hidden << " s ("
+                  << (max_times[0] > 0. ? 100.0 * hidden / max_times[0] : 0.) << " %)" << std::endl;
+    }
+}
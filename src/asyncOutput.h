@@ -0,0 +1,51 @@
+#ifndef ASYNC_OUTPUT_H
+#define ASYNC_OUTPUT_H
+
+#include <iostream>
+#include <vector>
+#include <cstring>              // memcpy
+#include <thread>               // std::thread
+#include <mutex>                // std::mutex, std::unique_lock
+#include <condition_variable>   // std::condition_variable
+#include <deque>                // std::deque
+#include <functional>           // std::function
+#include <mpi.h>                // MPI header files
+
+// a background thread that writes snapshot frames while the solver keeps stepping
+//
+// at a frame step the interior of the field is copied into one of two output buffers and handed to
+// the thread; the solver only blocks when both buffers are still waiting to be written
+
+typedef std::function<void(const int, const double*, const MPI_Comm)> frame_writer;   // (time, field, communicator) --> files
+
+struct output_frame
+{
+    int time;      // lattice time of the frame
+    int buffer;    // output buffer holding the field
+};
+
+struct output_thread
+{
+    bool                             active;      // false --> frames are written immediately by the caller
+    bool                             stop;        // tells the thread to finish the queue and exit
+    int                              nn;          // ghost layers of the field
+    int                              LX, LY, LZ;  // interior nodes of the field
+    long long                        SX, SY;      // row stride and rows per plane of the field
+    std::vector<double>              buffer[2];   // copies of the field being written (same layout, interior only)
+    bool                             in_use[2];   // buffer holds a frame not yet written
+    std::deque<output_frame>         frames;      // queue of frames to write
+    frame_writer                     writer;      // writes one frame (only ever called by one thread at a time)
+    MPI_Comm                         comm;        // communicator passed to the writer (private to the thread if it runs collectives)
+    bool                             own_comm;    // comm is a duplicate to be freed at the end
+    std::mutex                       mutex;       // protects all members above
+    std::condition_variable          wake;        // signals the thread that a frame was posted
+    std::condition_variable          done;        // signals the solver that a buffer became free
+    std::thread                      worker;      // the output thread itself
+    int                              written;     // frames written
+    int                              last_time;   // lattice time of the last frame written (-1: none)
+    double                           write_time;  // time spent writing frames
+    double                           copy_time;   // time the solver spent copying fields into buffers
+    double                           wait_time;   // time the solver spent waiting for a free buffer (or writing itself)
+};
+
+#endif
@@ -0,0 +1,179 @@
+#include "autotune.h"
+
+/**
+Startup search for the fastest rank-mode kernel variant
+
+Which kernel sequence wins (full or windowed force stencil, separate or fused
+collision, regular or streaming stores) depends on the machine and on the
+sub-domain size LX x LY x LZ. The variants agree to rounding, so the
+search simply runs the first time steps of the simulation: every candidate
+drives "steps" real steps, including its halo exchanges, and is scored by its
+fastest step on the slowest rank. All ranks switch together, because the
+fused variant exchanges rho alone while the others exchange rho, u, v and w.
+
+The winner is appended to a cache file under a key made of the CPU model and
+the sub-domain size of rank 0; a later run with the same key skips the search.
+*/
+
+static const char* collide_names[COLLIDE_VARIANTS] = {"calc_dPdt + updateMacro + updateEquilibrium",
+                                                      "calc_dPdtWindow + updateMacro + updateEquilibrium",
+                                                      "collideFused"};
+
+// CPU model as reported by the kernel (x86 "model name", otherwise unknown)
+
+static std::string cpuModel()
+{
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while(std::getline(cpuinfo, line))
+    {
+        if(line.compare(0, 10, "model name") == 0)
+        {
+            size_t colon = line.find(':');
+            if(colon != std::string::npos) return line.substr(line.find_first_not_of(" \t", colon + 1));
+        }
+    }
+    return "unknown cpu";
+}
+
+void autotuneSetup(autotuner & tuner,
+                   const bool  enabled,          // search, or always use the default variant
+                   const int   steps,            // time steps per candidate
+                   const kernel_variant & fallback,  // variant used without a search
+                   const char* cache_file,       // file holding earlier choices
+                   const int   LX, const int LY, const int LZ,
+                   const int   myid,
+                   const MPI_Comm CART_COMM)
+{
+    tuner.active  = false;
+    tuner.cached  = false;
+    tuner.current = 0;
+    tuner.step    = 0;
+    tuner.steps   = std::max(steps, 1);
+    tuner.best    = fallback;
+    tuner.candidates.clear();
+    tuner.seconds.clear();
+
+    if(!enabled) return;
+
+    std::stringstream key;
+    key << cpuModel() << '\t' << LX << 'x' << LY << 'x' << LZ;
+    tuner.key = key.str();
+
+    // rank 0 looks the key up (the last matching line wins) and tells everybody;
+    // an entry with an unknown kernel or store mode (stale or corrupt file) means a new search
+
+    int found[3] = {0, fallback.collide, fallback.stores};
+    if(myid == 0)
+    {
+        std::ifstream cache(cache_file);
+        std::string line;
+        while(std::getline(cache, line))
+        {
+            if(line.compare(0, tuner.key.size() + 1, tuner.key + '\t') != 0) continue;
+            std::istringstream fields(line.substr(tuner.key.size() + 1));
+            int collide, stores;
+            if(fields >> collide >> stores && collide >= 0 && collide < COLLIDE_VARIANTS &&
+               stores >= 0 && stores < 2)   // candidates use NT_STORES_OFF or NT_STORES_ON
+            {
+                found[0] = 1;
+                found[1] = collide;
+                found[2] = stores;
+            }
+            else
+            {
+                found[0] = 0;
+                found[1] = fallback.collide;
+                found[2] = fallback.stores;
+                std::cout << "WARNING: ignoring invalid entry in " << cache_file << ": " << line << std::endl;
+            }
+        }
+    }
+    MPI_Bcast(found, 3, MPI_INT, 0, CART_COMM);
+
+    if(found[0])
+    {
+        tuner.cached       = true;
+        tuner.best.collide = found[1];
+        tuner.best.stores  = found[2];
+        return;
+    }
+
+    for(int collide = 0; collide < COLLIDE_VARIANTS; collide++) {
+        for(int stores = 0; stores < 2; stores++) {
+            kernel_variant candidate = {collide, stores};
+            tuner.candidates.push_back(candidate);
+            tuner.seconds.push_back(1.0e30);
+        }
+    }
+    tuner.active = true;
+}
+
+// variant for the next time step
+
+kernel_variant autotuneVariant(const autotuner & tuner)
+{
+    return tuner.active ? tuner.candidates[tuner.current] : tuner.best;
+}
+
+// record the duration of a step run with autotuneVariant(); picks the winner after the last candidate
+
+void autotuneRecord(autotuner & tuner, const double seconds, const char* cache_file,
+                    const int myid, const MPI_Comm CART_COMM)
+{
+    if(!tuner.active) return;
+
+    double slowest;
+    MPI_Allreduce(&seconds, &slowest, 1, MPI_DOUBLE, MPI_MAX, CART_COMM);
+
+    tuner.seconds[tuner.current] = std::min(tuner.seconds[tuner.current], slowest);
+
+    if(++tuner.step < tuner.steps) return;
+
+    tuner.step = 0;
+    if(++tuner.current < (int) tuner.candidates.size()) return;
+
+    // search finished
+
+    int fastest = 0;
+    for(size_t c = 1; c < tuner.candidates.size(); c++)
+    {
+        if(tuner.seconds[c] < tuner.seconds[fastest]) fastest = c;
+    }
+    tuner.best   = tuner.candidates[fastest];
+    tuner.active = false;
+
+    if(myid == 0)
+    {
+        std::ofstream cache(cache_file, std::ios::app);
+        cache << tuner.key << '\t' << tuner.best.collide << '\t' << tuner.best.stores
+              << '\t' << tuner.seconds[fastest] << std::endl;
+        if(!cache) std::cout << "autotune: could not write " << cache_file << std::endl;
+    }
+}
+
+void autotuneReport(const autotuner & tuner, const bool enabled, const int myid)
+{
+    if(!enabled || myid != 0) return;
+
+    std::cout << std::endl;
+    std::cout << "kernel autotuning       : " << tuner.key << std::endl;
+    if(tuner.active)
+    {
+        std::cout << "  search not finished (" << tuner.current << " of " << tuner.candidates.size()
+                  << " candidates timed), increase MAXIMUM_TIME" << std::endl;
+        return;
+    }
+    if(tuner.cached)
+    {
+        std::cout << "  taken from the cache file" << std::endl;
+    }
+    for(size_t c = 0; c < tuner.candidates.size(); c++)
+    {
+        std::cout << "  " << collide_names[tuner.candidates[c].collide]
+                  << (tuner.candidates[c].stores ? ", streaming stores" : ", regular stores")
+                  << " : " << tuner.seconds[c] << " s per step" << std::endl;
+    }
+    std::cout << "  selected: " << collide_names[tuner.best.collide]
+              << (tuner.best.stores ? ", streaming stores" : ", regular stores") << std::endl;
+}
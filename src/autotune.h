@@ -0,0 +1,43 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>  // std::min, std::max
+#include <mpi.h>      // MPI header files
+
+// kernel sequence for one rank-mode time step (all agree to rounding)
+
+enum
+{
+    COLLIDE_UNFUSED = 0,   // calc_dPdt + updateMacro + updateEquilibrium
+    COLLIDE_WINDOW  = 1,   // calc_dPdtWindow + updateMacro + updateEquilibrium
+    COLLIDE_FUSED   = 2,   // collideFused (no u, v, w and dPdt fields)
+    COLLIDE_VARIANTS = 3
+};
+
+struct kernel_variant
+{
+    int collide;   // COLLIDE_*
+    int stores;    // NT_STORES_OFF or NT_STORES_ON for the write-only outputs
+};
+
+// search state: every candidate runs "steps" real time steps, the fastest is kept
+
+struct autotuner
+{
+    bool                         active;      // still timing candidates
+    bool                         cached;      // choice taken from the cache file
+    std::string                  key;         // CPU model and sub-domain size
+    std::vector<kernel_variant>  candidates;
+    std::vector<double>          seconds;     // fastest step of every candidate (slowest rank)
+    int                          current;     // candidate being timed
+    int                          step;        // steps done with the current candidate
+    int                          steps;       // steps timed per candidate
+    kernel_variant               best;        // variant used once the search is over
+};
+
+#endif
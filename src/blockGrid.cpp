@@ -0,0 +1,563 @@
+#include "blockGrid.h"
+
+/**
+Block-structured (over-decomposed) local sub-domain
+
+Instead of one LX x LY x LZ box, the rank holds NBX x NBY x NBZ small blocks
+of roughly block_size^3 nodes. Every block has its own ghost layer and is
+advanced by the unmodified kernels (streaming, calc_dPdt, updateMacro,
+updateEquilibrium) called with the block dimensions.
+
+Each time step is one run of a task graph:
+
+   kernel task (one per block)     -- advance the block by one step
+   pack task   (one per direction) -- copy boundary nodes into the message for
+                                      one of the 18 D3Q19 neighbor ranks
+   halo task   (one per block)     -- refill the ghost layer from neighboring
+                                      blocks and from received messages
+
+A halo task only waits for the kernel tasks of the blocks it copies from and
+for the messages it needs, so interior blocks refill their ghost layers while
+boundary data is still travelling between ranks. Messages go directly to all
+18 face and edge neighbors, so no ordering between X, Y and Z exchanges is
+needed.
+
+Ghost values exchanged per node: rho, f[Q] and f_eq[Q].
+
+Quiescent blocks (skip_quiescent): a uniform state (same rho, f and f_eq at
+every node) is a fixed point of streaming, calc_dPdt and updateMacro. After
+its ghost layer has been refilled, a block whose interior and ghost nodes all
+match within quiescent_tol is marked inactive and its next kernel task does
+nothing. The check is repeated every step, so the block wakes up as soon as a
+neighboring block (on this or another rank) changes its ghost layer.
+*/
+
+// even split of n nodes into parts pieces: first node of piece p
+
+static int splitBegin(const int n, const int parts, const int p)
+{
+    return (p * n) / parts;
+}
+
+// allocate a zero-initialized buffer
+
+static double* newField(const long long size)
+{
+    double *field = new double[size];
+    for(long long n = 0; n < size; n++) field[n] = 0.;
+    return field;
+}
+
+// next "size" values of the block storage (each field padded to whole cache lines)
+
+static double* takeField(double* & next, const long long size)
+{
+    double *field = next;
+    next += (size + 7) / 8 * 8;
+    return field;
+}
+
+// true if rho, f and f_eq at every interior and (filled) ghost node match the first interior node
+
+static bool isQuiescent(const lattice_block & block, const int nn, const int Q, const double tol)
+{
+    const int GBX = strideX(nn, block.BX);
+    const int GBY = strideY(nn, block.BX, block.BY);
+    const int ref = nn + GBX * (nn + GBY * nn);
+
+    const double *f_ref  = block.f    + Q*ref;
+    const double *eq_ref = block.f_eq + Q*ref;
+
+    // the reference node itself must be at equilibrium
+    for(int a = 0; a < Q; a++) if(fabs(f_ref[a] - eq_ref[a]) > tol) return false;
+
+    // compare one node with the reference node
+    auto same = [&](const int n)
+    {
+        if(fabs(block.rho[n] - block.rho[ref]) > tol) return false;
+        for(int a = 0; a < Q; a++) if(fabs(block.f[Q*n + a]    - f_ref[a])  > tol) return false;
+        for(int a = 0; a < Q; a++) if(fabs(block.f_eq[Q*n + a] - eq_ref[a]) > tol) return false;
+        return true;
+    };
+
+    for(size_t n = 0; n < block.copy_dst.size(); n++) if(!same(block.copy_dst[n])) return false;
+    for(size_t n = 0; n < block.recv_dst.size(); n++) if(!same(block.recv_dst[n])) return false;
+
+    for(int k = 0; k < block.BZ; k++) {
+        for(int j = 0; j < block.BY; j++) {
+            for(int i = 0; i < block.BX; i++) {
+                if(!same((nn + i) + GBX * ((nn + j) + GBY * (nn + k)))) return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// set up blocks, ghost layer copy lists, messages and the task graph
+
+void blockGridSetup(block_grid     & grid,
+                    task_scheduler & sched,
+                    const int        nn,            // ghost layer thickness (must be 1)
+                    const int        Q,             // number of LBM streaming directions
+                    const int        LX,            // local nodes along X
+                    const int        LY,            // local nodes along Y
+                    const int        LZ,            // local nodes along Z
+                    const int        block_size,    // target number of nodes along each edge of a block
+                    double         * ex,            // D3Q19 directions
+                    double         * ey,
+                    double         * ez,
+                    double         * wt,            // weight factors
+                    double         * G11,           // cohesive force along the lattice directions
+                    const double     tau,           // relaxation time
+                    const bool       skip_quiescent,// skip the update of blocks that have reached a uniform state
+                    const double     quiescent_tol, // max. deviation from the uniform state
+                    const int        block_order,   // BRICK_ORDER_* (storage and scheduling order of the blocks)
+                    const MPI_Comm   CART_COMM,     // Cartesian communicator
+                    const int      * coords)        // coordinates of this rank in the Cartesian topology
+{
+    grid.nn   = nn;
+    grid.Q    = Q;
+    grid.LX   = LX;
+    grid.LY   = LY;
+    grid.LZ   = LZ;
+    grid.comm = CART_COMM;
+
+    grid.skip_quiescent = skip_quiescent;
+    grid.quiescent_tol  = quiescent_tol;
+    grid.steps          = 0;
+    grid.skipped        = 0;
+
+    grid.NBX = (LX + block_size - 1) / block_size;
+    grid.NBY = (LY + block_size - 1) / block_size;
+    grid.NBZ = (LZ + block_size - 1) / block_size;
+
+    // block that owns each rank-local node along X, Y and Z
+
+    std::vector<int> bx_of(LX), by_of(LY), bz_of(LZ);
+    for(int b = 0; b < grid.NBX; b++) for(int i = splitBegin(LX, grid.NBX, b); i < splitBegin(LX, grid.NBX, b+1); i++) bx_of[i] = b;
+    for(int b = 0; b < grid.NBY; b++) for(int j = splitBegin(LY, grid.NBY, b); j < splitBegin(LY, grid.NBY, b+1); j++) by_of[j] = b;
+    for(int b = 0; b < grid.NBZ; b++) for(int k = splitBegin(LZ, grid.NBZ, b); k < splitBegin(LZ, grid.NBZ, b+1); k++) bz_of[k] = b;
+
+    // create the blocks (stored along the requested curve)
+
+    brickOrderSetup(grid.order, block_order, grid.NBX, grid.NBY, grid.NBZ);
+
+    grid.blocks.resize(grid.NBX * grid.NBY * grid.NBZ);
+    for(int bk = 0; bk < grid.NBZ; bk++) {
+        for(int bj = 0; bj < grid.NBY; bj++) {
+            for(int bi = 0; bi < grid.NBX; bi++) {
+                lattice_block & block = grid.blocks[brickSlot(grid.order, bi, bj, bk)];
+                block.x0 = splitBegin(LX, grid.NBX, bi);
+                block.y0 = splitBegin(LY, grid.NBY, bj);
+                block.z0 = splitBegin(LZ, grid.NBZ, bk);
+                block.BX = splitBegin(LX, grid.NBX, bi+1) - block.x0;
+                block.BY = splitBegin(LY, grid.NBY, bj+1) - block.y0;
+                block.BZ = splitBegin(LZ, grid.NBZ, bk+1) - block.z0;
+                block.active = true;
+            }
+        }
+    }
+
+    // one allocation for all fields, so blocks close along the curve are close in memory
+
+    auto blockSize = [&](const lattice_block & block)
+    {
+        return strideX(nn, block.BX) * strideY(nn, block.BX, block.BY) * (nn+block.BZ+nn);
+    };
+
+    long long total = 0;
+    for(size_t b = 0; b < grid.blocks.size(); b++) total += 7 * ((blockSize(grid.blocks[b]) + 7) / 8 * 8)
+                                                          + 3 * ((blockSize(grid.blocks[b]) * Q + 7) / 8 * 8);
+    grid.storage = newField(total);
+
+    double *next = grid.storage;
+    for(size_t b = 0; b < grid.blocks.size(); b++)
+    {
+        lattice_block & block = grid.blocks[b];
+        const long long size1 = blockSize(block);
+        block.rho    = takeField(next, size1);
+        block.u      = takeField(next, size1);
+        block.v      = takeField(next, size1);
+        block.w      = takeField(next, size1);
+        block.dPdt_x = takeField(next, size1);
+        block.dPdt_y = takeField(next, size1);
+        block.dPdt_z = takeField(next, size1);
+        block.f      = takeField(next, size1 * Q);
+        block.f_eq   = takeField(next, size1 * Q);
+        block.f_new  = takeField(next, size1 * Q);
+    }
+
+    // neighbor ranks and message sizes for the 18 D3Q19 directions
+    // (the region sent in direction id has the same shape as the ghost region received from direction id)
+
+    const int L[3] = {LX, LY, LZ};
+    grid.send_offset[1] = 0;
+    grid.recv_offset[1] = 0;
+    for(int id = 1; id < Q; id++)
+    {
+        int e[3] = {(int) ex[id], (int) ey[id], (int) ez[id]};
+
+        int nbr_coords[3] = {coords[0] + e[0], coords[1] + e[1], coords[2] + e[2]};
+        MPI_Cart_rank(CART_COMM, nbr_coords, &grid.nbr[id]);   // periodic directions wrap around
+
+        for(int od = 1; od < Q; od++)
+        {
+            if(ex[od] == -ex[id] && ey[od] == -ey[id] && ez[od] == -ez[id]) grid.opposite[id] = od;
+        }
+
+        int count = 1;
+        for(int a = 0; a < 3; a++) if(e[a] == 0) count *= L[a];
+        grid.send_offset[id+1] = grid.send_offset[id] + count;
+        grid.recv_offset[id+1] = grid.recv_offset[id] + count;
+
+        // boundary nodes sent in direction id, in the order the neighbor expects them
+
+        const int nx = (e[0] == 0) ? LX : 1;
+        const int ny = (e[1] == 0) ? LY : 1;
+        const int nz = (e[2] == 0) ? LZ : 1;
+        for(int rk = 0; rk < nz; rk++) {
+            for(int rj = 0; rj < ny; rj++) {
+                for(int ri = 0; ri < nx; ri++) {
+                    int i = (e[0] == 0) ? ri : ((e[0] > 0) ? LX-1 : 0);
+                    int j = (e[1] == 0) ? rj : ((e[1] > 0) ? LY-1 : 0);
+                    int k = (e[2] == 0) ? rk : ((e[2] > 0) ? LZ-1 : 0);
+                    int b = brickSlot(grid.order, bx_of[i], by_of[j], bz_of[k]);
+                    const lattice_block & block = grid.blocks[b];
+                    grid.send_block.push_back(b);
+                    grid.send_node.push_back(brickNode(nn, block.BX, block.BY, i - block.x0, j - block.y0, k - block.z0));
+                }
+            }
+        }
+    }
+
+    const int W = 1 + 2*Q;   // halo values per node: rho, f[Q], f_eq[Q]
+    grid.send_buf = newField(W * grid.send_offset[Q]);
+    grid.recv_buf = newField(W * grid.recv_offset[Q]);
+
+    // ghost layer copy lists: every ghost node reachable by a D3Q19 direction (corners are not needed)
+
+    for(size_t b = 0; b < grid.blocks.size(); b++)
+    {
+        lattice_block & block = grid.blocks[b];
+        const int GBX = strideX(nn, block.BX);
+        const int GBY = strideY(nn, block.BX, block.BY);
+
+        for(int K = 0; K < nn + block.BZ + nn; K++) {
+            for(int J = 0; J < nn + block.BY + nn; J++) {
+                for(int I = 0; I < nn + block.BX + nn; I++) {
+                    int out = (I < nn || I >= nn + block.BX)
+                            + (J < nn || J >= nn + block.BY)
+                            + (K < nn || K >= nn + block.BZ);
+                    if(out == 0 || out == 3) continue;
+
+                    int dst = I + GBX * (J + GBY * K);
+
+                    // rank-local coordinates of this ghost node
+                    int g[3] = {block.x0 + I - nn, block.y0 + J - nn, block.z0 + K - nn};
+                    int e[3];
+                    for(int a = 0; a < 3; a++) e[a] = (g[a] < 0) ? -1 : ((g[a] >= L[a]) ? 1 : 0);
+
+                    if(e[0] == 0 && e[1] == 0 && e[2] == 0)
+                    {
+                        // interior node of another block on this rank
+                        int s = brickSlot(grid.order, bx_of[g[0]], by_of[g[1]], bz_of[g[2]]);
+                        const lattice_block & src = grid.blocks[s];
+                        block.copy_dst.push_back(dst);
+                        block.copy_block.push_back(s);
+                        block.copy_src.push_back(brickNode(nn, src.BX, src.BY, g[0] - src.x0, g[1] - src.y0, g[2] - src.z0));
+                    }
+                    else
+                    {
+                        // ghost node of the rank --> message from the neighbor in direction e
+                        int id = 1;
+                        while(!(ex[id] == e[0] && ey[id] == e[1] && ez[id] == e[2])) id++;
+                        int nx = (e[0] == 0) ? LX : 1;
+                        int ny = (e[1] == 0) ? LY : 1;
+                        int ri = (e[0] == 0) ? g[0] : 0;
+                        int rj = (e[1] == 0) ? g[1] : 0;
+                        int rk = (e[2] == 0) ? g[2] : 0;
+                        block.recv_dst.push_back(dst);
+                        block.recv_src.push_back(grid.recv_offset[id] + ri + nx * (rj + ny * rk));
+                    }
+                }
+            }
+        }
+    }
+
+    // task graph: kernel tasks
+
+    block_grid * pgrid = &grid;
+
+    for(size_t b = 0; b < grid.blocks.size(); b++)
+    {
+        lattice_block * block = &grid.blocks[b];
+        block->kernel_task = schedulerAddTask(sched, [=]()
+        {
+            if(!block->active)
+            {
+                pgrid->skipped++;
+                return;
+            }
+
+            streaming(nn, block->BX, block->BY, block->BZ, ex, ey, ez, tau, block->f, block->f_new, block->f_eq);
+
+            calc_dPdt(nn, block->BX, block->BY, block->BZ, ex, ey, ez, G11,
+                      block->rho, block->dPdt_x, block->dPdt_y, block->dPdt_z);
+
+            updateMacro(nn, block->BX, block->BY, block->BZ, ex, ey, ez, wt, tau,
+                        block->rho, block->u, block->v, block->w,
+                        block->dPdt_x, block->dPdt_y, block->dPdt_z, block->f);
+
+            updateEquilibrium(nn, block->BX, block->BY, block->BZ, ex, ey, ez, wt,
+                              block->rho, block->u, block->v, block->w, block->f_eq);
+
+            // f_new becomes f (its ghost layer is refilled by the halo task)
+            double *swap = block->f;
+            block->f     = block->f_new;
+            block->f_new = swap;
+        }, 0);
+    }
+
+    // pack tasks (one per neighbor direction)
+
+    for(int id = 1; id < Q; id++)
+    {
+        grid.pack_task[id] = schedulerAddTask(sched, [=]()
+        {
+            for(int n = pgrid->send_offset[id]; n < pgrid->send_offset[id+1]; n++)
+            {
+                const lattice_block & block = pgrid->blocks[pgrid->send_block[n]];
+                const int node = pgrid->send_node[n];
+                double *buf = pgrid->send_buf + W*n;
+                buf[0] = block.rho[node];
+                for(int a = 0; a < Q; a++) buf[1 + a]     = block.f[Q*node + a];
+                for(int a = 0; a < Q; a++) buf[1 + Q + a] = block.f_eq[Q*node + a];
+            }
+            pgrid->packed[id] = 1;
+        }, 0);
+
+        std::vector<bool> needed(grid.blocks.size(), false);
+        for(int n = grid.send_offset[id]; n < grid.send_offset[id+1]; n++) needed[grid.send_block[n]] = true;
+        for(size_t b = 0; b < grid.blocks.size(); b++)
+        {
+            if(needed[b]) schedulerAddDependency(sched, grid.blocks[b].kernel_task, grid.pack_task[id]);
+        }
+    }
+
+    // halo tasks (one per block)
+
+    for(size_t b = 0; b < grid.blocks.size(); b++)
+    {
+        lattice_block * block = &grid.blocks[b];
+
+        // messages this block is waiting for
+        std::vector<bool> from(Q, false);
+        for(size_t n = 0; n < block->recv_src.size(); n++)
+        {
+            int id = 1;
+            while(block->recv_src[n] >= grid.recv_offset[id+1]) id++;
+            from[id] = true;
+        }
+        int num_messages = 0;
+        for(int id = 1; id < Q; id++) if(from[id]) num_messages++;
+
+        block->halo_task = schedulerAddTask(sched, [=]()
+        {
+            for(size_t n = 0; n < block->copy_dst.size(); n++)
+            {
+                const lattice_block & src = pgrid->blocks[block->copy_block[n]];
+                const int d = block->copy_dst[n];
+                const int s = block->copy_src[n];
+                block->rho[d] = src.rho[s];
+                for(int a = 0; a < Q; a++) block->f[Q*d + a]    = src.f[Q*s + a];
+                for(int a = 0; a < Q; a++) block->f_eq[Q*d + a] = src.f_eq[Q*s + a];
+            }
+            for(size_t n = 0; n < block->recv_dst.size(); n++)
+            {
+                const int d = block->recv_dst[n];
+                const double *buf = pgrid->recv_buf + W*block->recv_src[n];
+                block->rho[d] = buf[0];
+                for(int a = 0; a < Q; a++) block->f[Q*d + a]    = buf[1 + a];
+                for(int a = 0; a < Q; a++) block->f_eq[Q*d + a] = buf[1 + Q + a];
+            }
+
+            // decide whether the next step of this block can be skipped
+            if(pgrid->skip_quiescent) block->active = !isQuiescent(*block, nn, Q, pgrid->quiescent_tol);
+        }, num_messages);
+
+        for(int id = 1; id < Q; id++) if(from[id]) grid.recv_tasks[id].push_back(block->halo_task);
+
+        // this block's own kernels read the old ghost layer, neighbors' kernels produce the new one
+        std::vector<bool> source(grid.blocks.size(), false);
+        source[b] = true;
+        for(size_t n = 0; n < block->copy_block.size(); n++) source[block->copy_block[n]] = true;
+        for(size_t s = 0; s < grid.blocks.size(); s++)
+        {
+            if(source[s]) schedulerAddDependency(sched, grid.blocks[s].kernel_task, block->halo_task);
+        }
+    }
+}
+
+// copy the rank-level fields (ghost layers included) into the blocks
+
+void blockScatter(block_grid & grid,
+                  const double* rho, const double* u, const double* v, const double* w,
+                  const double* f, const double* f_eq, const double* f_new)
+{
+    const int nn = grid.nn;
+    const int Q  = grid.Q;
+    const long long GX = strideX(nn, grid.LX);
+    const long long GY = strideY(nn, grid.LX, grid.LY);
+
+    for(size_t b = 0; b < grid.blocks.size(); b++)
+    {
+        lattice_block & block = grid.blocks[b];
+        const int GBX = strideX(nn, block.BX);
+        const int GBY = strideY(nn, block.BX, block.BY);
+
+        for(int K = 0; K < nn + block.BZ + nn; K++) {
+            for(int J = 0; J < nn + block.BY + nn; J++) {
+                for(int I = 0; I < nn + block.BX + nn; I++) {
+                    int n = I + GBX * (J + GBY * K);
+                    long long N = (block.x0 + I) + GX * ((block.y0 + J) + GY * (block.z0 + K));
+                    block.rho[n] = rho[N];
+                    block.u[n]   = u[N];
+                    block.v[n]   = v[N];
+                    block.w[n]   = w[N];
+                    for(int a = 0; a < Q; a++)
+                    {
+                        block.f[Q*n + a]     = f[Q*N + a];
+                        block.f_eq[Q*n + a]  = f_eq[Q*N + a];
+                        block.f_new[Q*n + a] = f_new[Q*N + a];
+                    }
+                }
+            }
+        }
+    }
+}
+
+// copy the interior density of all blocks into the rank-level buffer
+
+void blockGather(const block_grid & grid, double* rho)
+{
+    const int nn = grid.nn;
+    const long long GX = strideX(nn, grid.LX);
+    const long long GY = strideY(nn, grid.LX, grid.LY);
+
+    for(size_t b = 0; b < grid.blocks.size(); b++)
+    {
+        const lattice_block & block = grid.blocks[b];
+        const int GBX = strideX(nn, block.BX);
+        const int GBY = strideY(nn, block.BX, block.BY);
+
+        for(int k = 0; k < block.BZ; k++) {
+            for(int j = 0; j < block.BY; j++) {
+                for(int i = 0; i < block.BX; i++) {
+                    int n = (nn + i) + GBX * ((nn + j) + GBY * (nn + k));
+                    long long N = (nn + block.x0 + i) + GX * ((nn + block.y0 + j) + GY * (nn + block.z0 + k));
+                    rho[N] = block.rho[n];
+                }
+            }
+        }
+    }
+}
+
+// advance all blocks by one time step
+
+void blockStep(block_grid & grid, task_scheduler & sched)
+{
+    const int Q = grid.Q;
+    const int W = 1 + 2*Q;
+
+    // post receives for the ghost regions of the rank
+
+    for(int id = 1; id < Q; id++)
+    {
+        grid.packed[id]   = 0;
+        grid.sent[id]     = false;
+        grid.received[id] = false;
+
+        int count = grid.recv_offset[id+1] - grid.recv_offset[id];
+        MPI_Irecv(grid.recv_buf + W*grid.recv_offset[id], W*count, MPI_DOUBLE,
+                  grid.nbr[id], 100 + grid.opposite[id], grid.comm, &grid.recv_req[id]);
+    }
+
+    // called by this thread only: send packed messages, release halo tasks whose messages arrived
+
+    std::function<void()> poll = [&]()
+    {
+        for(int id = 1; id < Q; id++)
+        {
+            if(!grid.sent[id] && grid.packed[id])
+            {
+                int count = grid.send_offset[id+1] - grid.send_offset[id];
+                MPI_Isend(grid.send_buf + W*grid.send_offset[id], W*count, MPI_DOUBLE,
+                          grid.nbr[id], 100 + id, grid.comm, &grid.send_req[id]);
+                grid.sent[id] = true;
+            }
+
+            if(!grid.received[id])
+            {
+                int flag;
+                MPI_Test(&grid.recv_req[id], &flag, MPI_STATUS_IGNORE);
+                if(flag)
+                {
+                    grid.received[id] = true;
+                    for(size_t t = 0; t < grid.recv_tasks[id].size(); t++) schedulerRelease(sched, grid.recv_tasks[id][t]);
+                }
+            }
+        }
+    };
+
+    schedulerRun(sched, poll);
+
+    // messages packed by the very last tasks, then make the send buffer reusable
+
+    poll();
+    MPI_Waitall(Q-1, &grid.send_req[1], MPI_STATUSES_IGNORE);
+
+    grid.steps++;
+}
+
+// print the fraction of block updates skipped because the blocks were quiescent
+
+void blockReport(const block_grid & grid, const int myid)
+{
+    long long local[2] = {grid.skipped, grid.steps * (long long) grid.blocks.size()};
+    long long total[2] = {0, 0};
+    MPI_Reduce(local, total, 2, MPI_LONG_LONG, MPI_SUM, 0, grid.comm);
+
+    if(myid != 0) return;
+
+    const char* curves[] = {"lexicographic", "Morton", "Hilbert"};
+    std::cout << "block order             : " << curves[grid.order.curve] << ", "
+              << grid.NBX << " x " << grid.NBY << " x " << grid.NBZ << " blocks, "
+              << 100.0 * brickOrderLocality(grid.order, 8) << " % of face neighbors within 8 blocks in memory" << std::endl;
+
+    if(!grid.skip_quiescent) return;
+
+    std::cout << "quiescent blocks skipped : " << total[0] << " of " << total[1] << " block updates";
+    if(total[1] > 0) std::cout << " (" << 100.0 * total[0] / total[1] << " %)";
+    std::cout << std::endl;
+}
+
+// release all block storage
+
+void blockGridFree(block_grid & grid)
+{
+    for(size_t b = 0; b < grid.blocks.size(); b++)
+    {
+        lattice_block & block = grid.blocks[b];
+        block.rho = block.u = block.v = block.w = NULL;
+        block.dPdt_x = block.dPdt_y = block.dPdt_z = NULL;
+        block.f = block.f_eq = block.f_new = NULL;
+    }
+    grid.blocks.clear();
+
+    delete [] grid.storage;
+    grid.storage = NULL;
+
+    delete [] grid.send_buf;
+    delete [] grid.recv_buf;
+}
@@ -0,0 +1,114 @@
+#ifndef BLOCK_GRID_H
+#define BLOCK_GRID_H
+
+#include <iostream>
+#include <vector>
+#include <cmath>      // fabs
+#include <atomic>     // std::atomic
+#include <mpi.h>      // MPI header files
+
+#include "taskScheduler.h"
+#include "latticeArena.h"  // strideX, strideY
+#include "brickOrder.h"    // brick_order, brickSlot, brickNode
+
+// one small block of the local sub-domain, with its own ghost layer
+
+struct lattice_block
+{
+    int     x0, y0, z0;          // rank-local (i,j,k) of the first interior node of this block
+    int     BX, BY, BZ;          // interior nodes along X, Y and Z
+
+    double *rho, *u, *v, *w;     // macroscopic variables (ghost layer included)
+    double *dPdt_x;              // momentum change because of inter-particle forces
+    double *dPdt_y;
+    double *dPdt_z;
+    double *f, *f_eq, *f_new;    // PDFs (ghost layer included)
+
+    std::vector<int> copy_dst;   // ghost node filled from another block on this rank
+    std::vector<int> copy_block; // ... the block it comes from
+    std::vector<int> copy_src;   // ... and the interior node in that block
+    std::vector<int> recv_dst;   // ghost node filled from a neighboring rank
+    std::vector<int> recv_src;   // ... and its position (in nodes) in the receive buffer
+
+    int     kernel_task;         // scheduler task that advances this block by one step
+    int     halo_task;           // scheduler task that refills the ghost layer
+
+    bool    active;              // false: block and ghost layer are uniform, the next step is skipped
+};
+
+// all blocks of this rank plus the messages exchanged with the 18 D3Q19 neighbor ranks
+
+struct block_grid
+{
+    int     nn;                      // ghost layer thickness (blocks and rank)
+    int     Q;                       // number of LBM streaming directions
+    int     LX, LY, LZ;              // local nodes of this rank
+    int     NBX, NBY, NBZ;           // blocks along X, Y and Z
+    std::vector<lattice_block> blocks;  // stored (and scheduled) in the order of "order"
+    brick_order order;               // position of block (bi,bj,bk) in blocks
+    double *storage;                 // fields of all blocks, block after block in storage order
+
+    int     nbr[19];                 // neighbor rank in direction id (D3Q19 numbering)
+    int     opposite[19];            // direction pointing the other way
+    int     send_offset[20];         // first node of each direction in the send buffer
+    int     recv_offset[20];         // first node of each direction in the receive buffer
+    std::vector<int> send_block;     // block holding each node of the send buffer
+    std::vector<int> send_node;      // ... and its index inside that block
+    double *send_buf;                // halo values of all boundary nodes, direction by direction
+    double *recv_buf;
+    MPI_Request send_req[19];
+    MPI_Request recv_req[19];
+    std::atomic<int> packed[19];     // send buffer for direction id is ready
+    bool    sent[19];                // message for direction id has been posted
+    bool    received[19];            // message from direction id has arrived
+    std::vector<int> recv_tasks[19]; // halo tasks waiting for the message from direction id
+    int     pack_task[19];           // scheduler task packing the message for direction id
+
+    bool    skip_quiescent;          // skip blocks that have reached a uniform fixed point
+    double  quiescent_tol;           // max. deviation of rho, f and f_eq from a uniform state
+    long long steps;                 // time steps taken in block mode
+    std::atomic<long long> skipped;  // block updates skipped because the block was quiescent
+
+    MPI_Comm comm;                   // Cartesian communicator
+};
+
+// task graph execution (see taskScheduler.cpp)
+
+extern int schedulerAddTask(task_scheduler & sched, const std::function<void()> & run, const int external_deps);
+
+extern void schedulerAddDependency(task_scheduler & sched, const int before, const int after);
+
+extern void schedulerRelease(task_scheduler & sched, const int t);
+
+extern void schedulerRun(task_scheduler & sched, const std::function<void()> & poll);
+
+// order of the blocks along a space-filling curve (see brickOrder.cpp)
+
+extern void brickOrderSetup(brick_order & order, const int curve, const int NBX, const int NBY, const int NBZ);
+
+extern double brickOrderLocality(const brick_order & order, const int window);
+
+// kernels applied to every block (see the corresponding .cpp files)
+
+extern void streaming(const int nn, const int NX, const int NY, const int NZ,
+                      double* ex, double* ey, double* ez, double tau,
+                      double* f, double* f_new, double* f_eq);
+
+extern void calc_dPdt(const int nn, const int NX, const int NY, const double NZ,
+                      double* ex, double* ey, double* ez, double* G11,
+                      double* rho, double* dPdt_x, double* dPdt_y, double* dPdt_z);
+
+extern void updateMacro(const int nn, const int NX, const int NY, const int NZ,
+                        double* ex, double* ey, double* ez, double* wt,
+                        double tau,
+                        double* rho, double* u, double* v, double* w,
+                        double* dPdt_x, double* dPdt_y, double* dPdt_z,
+                        double* f);
+
+extern void updateEquilibrium(const int nn, const int NX, const int NY, const int NZ,
+                              double* ex, double* ey, double* ez, double* wt,
+                              const double* rho,
+                              const double* u, const double* v, const double* w,
+                              double* f_eq);
+
+#endif
@@ -0,0 +1,131 @@
+#include "brickOrder.h"
+
+/**
+Space-filling-curve order of the bricks of a rank
+
+The nodes of a rank are stored brick by brick (every brick is a block of the
+block grid, with its own ghost layer and lexicographic order inside). Along
+a lexicographic sequence of bricks, the brick above the current one in Z is
+NBX*NBY bricks away in memory. Along a Morton or Hilbert curve, bricks that
+are close in space are mostly close in memory too, and consecutive kernel
+tasks work on neighboring bricks whose ghost layers they share.
+
+The curve is laid over the smallest power-of-two cube enclosing the brick
+grid. Bricks outside the grid are skipped, so the order is still a
+permutation of the existing bricks.
+*/
+
+// interleave the bits of x, y and z (x in the lowest position)
+
+static long long mortonKey(const unsigned int x, const unsigned int y, const unsigned int z, const int bits)
+{
+    long long key = 0;
+    for(int b = bits - 1; b >= 0; b--)
+    {
+        key = (key << 1) | ((z >> b) & 1);
+        key = (key << 1) | ((y >> b) & 1);
+        key = (key << 1) | ((x >> b) & 1);
+    }
+    return key;
+}
+
+// distance along the 3D Hilbert curve (Skilling, "Programming the Hilbert curve", AIP Conf. Proc. 707, 2004)
+
+static long long hilbertKey(const unsigned int x, const unsigned int y, const unsigned int z, const int bits)
+{
+    unsigned int X[3] = {z, y, x};
+    const unsigned int M = 1u << (bits - 1);
+
+    // inverse undo excess work
+    for(unsigned int q = M; q > 1; q >>= 1)
+    {
+        const unsigned int p = q - 1;
+        for(int i = 0; i < 3; i++)
+        {
+            if(X[i] & q)
+            {
+                X[0] ^= p;
+            }
+            else
+            {
+                unsigned int t = (X[0] ^ X[i]) & p;
+                X[0] ^= t;
+                X[i] ^= t;
+            }
+        }
+    }
+
+    // Gray encode
+    for(int i = 1; i < 3; i++) X[i] ^= X[i-1];
+    unsigned int t = 0;
+    for(unsigned int q = M; q > 1; q >>= 1) if(X[2] & q) t ^= q - 1;
+    for(int i = 0; i < 3; i++) X[i] ^= t;
+
+    // the transposed form holds the key bits round-robin, most significant first
+    long long key = 0;
+    for(int b = bits - 1; b >= 0; b--) {
+        for(int i = 0; i < 3; i++) {
+            key = (key << 1) | ((X[i] >> b) & 1);
+        }
+    }
+    return key;
+}
+
+// assign every brick its storage position along the requested curve
+
+void brickOrderSetup(brick_order & order,
+                     const int     curve,    // BRICK_ORDER_*
+                     const int     NBX,      // bricks along X
+                     const int     NBY,      // bricks along Y
+                     const int     NBZ)      // bricks along Z
+{
+    order.curve = curve;
+    order.NBX   = NBX;
+    order.NBY   = NBY;
+    order.NBZ   = NBZ;
+
+    int bits = 1;
+    while((1 << bits) < std::max(NBX, std::max(NBY, NBZ))) bits++;
+
+    // (key, lexicographic brick index) for every brick
+    std::vector<std::pair<long long, int> > keys;
+    for(int bk = 0; bk < NBZ; bk++) {
+        for(int bj = 0; bj < NBY; bj++) {
+            for(int bi = 0; bi < NBX; bi++) {
+                int b = bi + NBX * (bj + NBY * bk);
+                long long key = b;
+                if(curve == BRICK_ORDER_MORTON)  key = mortonKey(bi, bj, bk, bits);
+                if(curve == BRICK_ORDER_HILBERT) key = hilbertKey(bi, bj, bk, bits);
+                keys.push_back(std::make_pair(key, b));
+            }
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+
+    order.slot.assign(keys.size(), 0);
+    for(size_t s = 0; s < keys.size(); s++) order.slot[keys[s].second] = (int) s;
+}
+
+// fraction of face-neighbor brick pairs stored at most "window" bricks apart
+
+double brickOrderLocality(const brick_order & order, const int window)
+{
+    long long near = 0;
+    long long pairs = 0;
+    auto count = [&](const int s0, const int s1)
+    {
+        if(abs(s1 - s0) <= window) near++;
+        pairs++;
+    };
+    for(int bk = 0; bk < order.NBZ; bk++) {
+        for(int bj = 0; bj < order.NBY; bj++) {
+            for(int bi = 0; bi < order.NBX; bi++) {
+                int s = brickSlot(order, bi, bj, bk);
+                if(bi + 1 < order.NBX) count(s, brickSlot(order, bi+1, bj, bk));
+                if(bj + 1 < order.NBY) count(s, brickSlot(order, bi, bj+1, bk));
+                if(bk + 1 < order.NBZ) count(s, brickSlot(order, bi, bj, bk+1));
+            }
+        }
+    }
+    return (pairs > 0) ? (double) near / pairs : 1.;
+}
@@ -0,0 +1,44 @@
+#ifndef BRICK_ORDER_H
+#define BRICK_ORDER_H
+
+#include <iostream>
+#include <vector>
+#include <algorithm>  // std::sort
+#include <cstdlib>    // abs
+
+#include "latticeArena.h"  // strideX, strideY
+
+// order in which the bricks (blocks) of a rank are stored and visited
+
+enum
+{
+    BRICK_ORDER_LEXICOGRAPHIC = 0,   // bi + NBX*(bj + NBY*bk)
+    BRICK_ORDER_MORTON        = 1,   // Z-order curve
+    BRICK_ORDER_HILBERT       = 2    // Hilbert curve (consecutive bricks always share a face)
+};
+
+struct brick_order
+{
+    int              curve;         // BRICK_ORDER_*
+    int              NBX, NBY, NBZ; // bricks along X, Y and Z
+    std::vector<int> slot;          // storage position of brick (bi,bj,bk), indexed lexicographically
+};
+
+// storage position of brick (bi,bj,bk)
+
+inline int brickSlot(const brick_order & order, const int bi, const int bj, const int bk)
+{
+    return order.slot[bi + order.NBX * (bj + order.NBY * bk)];
+}
+
+// brick-local index of interior node (i,j,k) of a BX x BY x BZ brick with ghost layers
+// (lexicographic inside the brick, the layout streaming and calc_dPdt work on)
+
+inline int brickNode(const int nn, const int BX, const int BY, const int i, const int j, const int k)
+{
+    const int GBX = strideX(nn, BX);
+    const int GBY = strideY(nn, BX, BY);
+    return (nn + i) + GBX * ((nn + j) + GBY * (nn + k));
+}
+
+#endif
@@ -2,21 +2,44 @@
 
       #include "calc_dPdt.h"
 
+//    equation of state used by psi() (NULL: original exponential form)
+
+      static const eos_table *active_eos = NULL;
+
+      void psiSetEOS(const eos_table *eos)
+      {
+        active_eos = eos;
+      }
+
 //    funtion to calculate effective density in the Shan & Chen model
 
       double psi(double x)
       {
+        if(active_eos) return eosPsi(*active_eos, x);
+
         const double E = 2.71828;
         const double rho0 = 1.0;
         return rho0 * (1 - pow(E, -x/rho0));
       }
 
+//    effective density for a whole array of densities (uses the vectorized table lookup if enabled)
+
+      void psiArray(const double* rho, double* out, const long long count)
+      {
+        if(active_eos)
+        {
+          eosPsiArray(*active_eos, rho, out, count);
+          return;
+        }
+        for(long long n = 0; n < count; n++) out[n] = psi(rho[n]);
+      }
+
       void calc_dPdt(const int nn, const int NX, const int NY, const double NZ,
                      double* ex, double* ey, double* ez, double* G11,
                      double* rho, double* dPdt_x, double* dPdt_y, double* dPdt_z)
       { 
-        const int GX = nn + NX + nn;
-        const int GY = nn + NY + nn;
+        const long long GX = strideX(nn, NX);
+        const long long GY = strideY(nn, NX, NY);
 
         // interparticle forces
         for(int k = 0; k < NZ; k++)
@@ -28,7 +51,7 @@
             for(int i = 0; i < NX; i++)
             {  
               int I = nn + i;
-              int N = I + GX*J + GX*GY*K;
+              long long N = I + GX*J + GX*GY*K;
               double Gsumx = 0.;
               double Gsumy = 0.;
               double Gsumz = 0.;
@@ -38,7 +61,7 @@
                 int jflow = J + ey[id];
                 int kflow = K + ez[id];
 
-                int Nflow = iflow + GX*jflow + GX*GY*kflow;
+                long long Nflow = iflow + GX*jflow + GX*GY*kflow;
 
                 double strength = psi(rho[N]) * psi(rho[Nflow]) * G11[id];
 
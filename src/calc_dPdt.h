@@ -4,4 +4,11 @@
       #include<iostream> // printf
       #include<cmath>    // pow
 
+      #include "equationOfState.h" // eos_table
+      #include "latticeArena.h"    // workspace, strideX, strideY
+
+      extern double eosPsi(const eos_table & eos, const double rho);
+
+      extern void eosPsiArray(const eos_table & eos, const double* rho, double* psi, const long long count);
+
 #endif
@@ -0,0 +1,106 @@
+//    calculate the change in momentum because of inter-particle forces
+//    (same force as calc_dPdt, with every psi value computed once and reused from a sliding window)
+
+      #include "calc_dPdt.h"
+
+      extern void psiArray(const double* rho, double* out, const long long count);   // effective density (see calc_dPdt.cpp)
+
+/**
+The D3Q19 stencil of node (I,J,K) touches the 9 pencils (J+dy, K+dz) with
+dy, dz in {-1,0,1}. psi is computed once per node into a ring of three
+XY-planes (K-1, K, K+1); while sweeping a pencil along I, every one of the 9
+neighbor pencils keeps psi at I-1, I and I+1 in registers, so moving to the
+next node loads one new psi value per pencil instead of evaluating psi 19
+times.
+
+With gw[p][ex+1] the interaction strength of the direction (ex, dy, dz) of
+pencil p (zero if D3Q19 has no such direction):
+
+   Gx = sum_p  gw[p][2]*psi(I+1) - gw[p][0]*psi(I-1)
+   Gy = sum_p  dy * (gw[p][0]*psi(I-1) + gw[p][1]*psi(I) + gw[p][2]*psi(I+1))
+   Gz = sum_p  dz * (  ... same window sum ...  )
+
+and dPdt = -psi(rho[N]) * (Gx, Gy, Gz), which equals calc_dPdt up to the
+order of the floating point additions.
+*/
+
+      void calc_dPdtWindow(const int nn, const int NX, const int NY, const int NZ,
+                           double* ex, double* ey, double* ez, double* G11,
+                           double* rho, double* dPdt_x, double* dPdt_y, double* dPdt_z)
+      {
+        const long long GX = strideX(nn, NX);
+        const long long GY = strideY(nn, NX, NY);
+        const long long plane = GX*GY;
+
+        // interaction strength per pencil p = (dy+1) + 3*(dz+1) and ex
+        double gw[9][3] = {{0.}};
+        for(int id = 0; id < 19; id++)
+        {
+          int p = ((int) ey[id] + 1) + 3*((int) ez[id] + 1);
+          gw[p][(int) ex[id] + 1] = G11[id];
+        }
+
+        // ring of three psi planes
+        double *psi_win = (double*) workspace(WORKSPACE_PSI_PLANES, 3*plane * sizeof(double));
+        auto fillPlane = [&](const int K)
+        {
+          psiArray(rho + K*plane, psi_win + (K % 3)*plane, plane);
+        };
+
+        fillPlane(nn - 1);
+        fillPlane(nn);
+
+        for(int k = 0; k < NZ; k++)
+        {
+          int K = nn + k;
+          fillPlane(K + 1);
+
+          for(int j = 0; j < NY; j++)
+          {
+            int J = nn + j;
+
+            // psi along the 9 neighbor pencils, and the window (I-1, I, I+1) on each of them
+            const double *row[9];
+            double pm[9], p0[9], pp[9];
+            for(int p = 0; p < 9; p++)
+            {
+              int dy = p % 3 - 1;
+              int dz = p / 3 - 1;
+              row[p] = psi_win + ((K + dz) % 3)*plane + (J + dy)*GX;
+              pm[p]  = row[p][nn - 1];
+              p0[p]  = row[p][nn];
+            }
+
+            for(int i = 0; i < NX; i++)
+            {
+              int I = nn + i;
+              long long N = I + GX*J + plane*K;
+
+              double Gsumx = 0.;
+              double Gsumy = 0.;
+              double Gsumz = 0.;
+              for(int p = 0; p < 9; p++)
+              {
+                pp[p] = row[p][I + 1];
+
+                double window = gw[p][0]*pm[p] + gw[p][1]*p0[p] + gw[p][2]*pp[p];
+                Gsumx += gw[p][2]*pp[p] - gw[p][0]*pm[p];
+                Gsumy += (p % 3 - 1) * window;
+                Gsumz += (p / 3 - 1) * window;
+              }
+
+              double psi_N = p0[4];   // pencil (J, K) itself
+              dPdt_x[N] = -psi_N * Gsumx;
+              dPdt_y[N] = -psi_N * Gsumy;
+              dPdt_z[N] = -psi_N * Gsumz;
+
+              // slide the window by one node
+              for(int p = 0; p < 9; p++)
+              {
+                pm[p] = p0[p];
+                p0[p] = pp[p];
+              }
+            }
+          }
+        }
+      }
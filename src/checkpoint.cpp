@@ -0,0 +1,320 @@
+#include "checkpoint.h"
+#include "latticeArena.h"   // strideX, strideY
+
+/**
+Checkpoint and restart of the full solver state
+
+At the start of a time step the solver needs f, f_eq and rho, and the
+narrow band also reads u, v and w (to find the interfaces) before
+updateMacro recomputes them. They cannot be rebuilt from the other fields:
+updateMacro takes them from the PDFs before the last streaming step, and
+the force in them comes from the density before that. A checkpoint therefore stores these six fields and the
+lattice time. dPdt is always recomputed before it is read.
+
+File layout (native byte order):
+
+  header   CHECKPOINT_HEADER long long values (magic, version, time,
+           global size, Q, process grid that wrote the file, whether
+           u, v and w were stored)
+  f        NZ x NY x NX nodes of Q values, X fastest
+  f_eq     same
+  rho      NZ x NY x NX values
+  u, v, w  same (zero if the writer ran without velocity fields, see below)
+
+Nothing in the file depends on the decomposition. Every rank describes its
+interior block with an MPI subarray type (in the file: its global offset,
+in memory: the interior of its array, ghost layers and stride padding
+skipped) and all ranks write or read their blocks collectively, so the
+MPI-IO layer can merge them into large contiguous requests. On restart
+every rank reads the block of its new x_range, y_range and z_range, and
+the process grid may differ from the one that wrote the file.
+
+Ghost layers are not stored: after a restart they are refilled by the
+same exchanges as after initialize().
+
+Without u, v and w (low-memory mode, or the fused kernel picked by the
+autotuner) a rank takes part in their collective writes with nothing to
+write, the file holds zeros there and its header says so. A restart reads
+them only if the file has them: without, the narrow band evaluates the
+force on every node in the first step, after which updateMacro has filled
+in u, v and w (see sc3d.cpp).
+
+The file is written under a temporary name and renamed once every rank has
+written its part, so a job killed while writing, or a write that fails,
+still leaves the previous checkpoint intact.
+*/
+
+static void fillHeader(long long* header, const int time, const int NX, const int NY, const int NZ,
+                       const int Q, const int* dims, const bool velocity)
+{
+    for(int h = 0; h < CHECKPOINT_HEADER; h++) header[h] = 0;
+    header[0] = CHECKPOINT_MAGIC;
+    header[1] = CHECKPOINT_VERSION;
+    header[2] = time;
+    header[3] = NX;
+    header[4] = NY;
+    header[5] = NZ;
+    header[6] = Q;
+    header[7] = dims[0];
+    header[8] = dims[1];
+    header[9] = dims[2];
+    header[CHECKPOINT_VELOCITY] = velocity ? 1 : 0;
+}
+
+// write (or read) the interior block of this rank of a field with "q" values per node,
+// stored as a global array starting "displacement" bytes into the file; returns the MPI-IO status
+
+static int fieldIO(MPI_File fh, const MPI_Offset displacement, const bool write, double* field, const int q,
+                    const int nn, const int LX, const int LY, const int LZ,
+                    const int NX, const int NY, const int NZ,
+                    const int x_beg, const int y_beg, const int z_beg)
+{
+    int global_size[4] = {NZ, NY, NX, q};
+    int block_size[4]  = {LZ, LY, LX, q};
+    int file_start[4]  = {z_beg, y_beg, x_beg, 0};
+
+    int array_size[4]  = {nn+LZ+nn, (int) strideY(nn, LX, LY), (int) strideX(nn, LX), q};
+    int array_start[4] = {nn, nn, nn, 0};
+
+    MPI_Datatype file_block, array_block;
+    MPI_Type_create_subarray(4, global_size, block_size, file_start,  MPI_ORDER_C, MPI_DOUBLE, &file_block);
+    MPI_Type_create_subarray(4, array_size,  block_size, array_start, MPI_ORDER_C, MPI_DOUBLE, &array_block);
+    MPI_Type_commit(&file_block);
+    MPI_Type_commit(&array_block);
+
+    MPI_File_set_view(fh, displacement, MPI_DOUBLE, file_block, "native", MPI_INFO_NULL);
+    // a missing field (NULL) still takes part in the collective call, with no data
+    const int count = field ? 1 : 0;
+    int status;
+    if(write) status = MPI_File_write_all(fh, field, count, array_block, MPI_STATUS_IGNORE);
+    else      status = MPI_File_read_all (fh, field, count, array_block, MPI_STATUS_IGNORE);
+
+    MPI_Type_free(&file_block);
+    MPI_Type_free(&array_block);
+
+    return status;
+}
+
+// write or read f, f_eq, rho, u, v and w (in this order after the header); false if any transfer failed
+
+static bool stateIO(MPI_File fh, const bool write, double* f, double* f_eq, double* rho,
+                    double* u, double* v, double* w,
+                    const int nn, const int Q, const int LX, const int LY, const int LZ,
+                    const int NX, const int NY, const int NZ,
+                    const int x_beg, const int y_beg, const int z_beg)
+{
+    const MPI_Offset nodes = (MPI_Offset) NX * NY * NZ;
+    const MPI_Offset begin = (MPI_Offset) CHECKPOINT_HEADER * sizeof(long long);
+    const MPI_Offset pdf_bytes = nodes * Q * sizeof(double);
+    const MPI_Offset mac_bytes = nodes * sizeof(double);
+
+    int failed = 0;
+    failed |= fieldIO(fh, begin,               write, f,    Q, nn, LX, LY, LZ, NX, NY, NZ, x_beg, y_beg, z_beg);
+    failed |= fieldIO(fh, begin + pdf_bytes,   write, f_eq, Q, nn, LX, LY, LZ, NX, NY, NZ, x_beg, y_beg, z_beg);
+    failed |= fieldIO(fh, begin + 2*pdf_bytes, write, rho,  1, nn, LX, LY, LZ, NX, NY, NZ, x_beg, y_beg, z_beg);
+
+    failed |= fieldIO(fh, begin + 2*pdf_bytes +   mac_bytes, write, u, 1, nn, LX, LY, LZ, NX, NY, NZ, x_beg, y_beg, z_beg);
+    failed |= fieldIO(fh, begin + 2*pdf_bytes + 2*mac_bytes, write, v, 1, nn, LX, LY, LZ, NX, NY, NZ, x_beg, y_beg, z_beg);
+    failed |= fieldIO(fh, begin + 2*pdf_bytes + 3*mac_bytes, write, w, 1, nn, LX, LY, LZ, NX, NY, NZ, x_beg, y_beg, z_beg);
+
+    return failed == MPI_SUCCESS;
+}
+
+// write f, f_eq, rho, u, v and w of all ranks in global index order
+
+void checkpointWrite(checkpoint_stats & ckpt,
+                     const char*      file_name,
+                     const int        time,
+                     const int        nn,
+                     const int        Q,
+                     const int        LX,
+                     const int        LY,
+                     const int        LZ,
+                     const int        NX,
+                     const int        NY,
+                     const int        NZ,
+                     const int        x_beg,
+                     const int        y_beg,
+                     const int        z_beg,
+                     const int*       dims,
+                     const double*    rho,
+                     const double*    f,
+                     const double*    f_eq,
+                     const double*    u,
+                     const double*    v,
+                     const double*    w,
+                     const int        myid,
+                     const MPI_Comm   CART_COMM)
+{
+    double t_beg = MPI_Wtime();
+
+    std::string temp_name = std::string(file_name) + ".tmp";
+
+    // (the open is collective, but check on all ranks: the collective writes below need every one)
+    MPI_File fh;
+    int opened = MPI_File_open(CART_COMM, temp_name.c_str(), MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh) == MPI_SUCCESS;
+    int all_opened;
+    MPI_Allreduce(&opened, &all_opened, 1, MPI_INT, MPI_MIN, CART_COMM);
+    if(!all_opened)
+    {
+        if(opened) MPI_File_close(&fh);
+        if(myid == 0) std::cout << "ERROR: cannot open " << temp_name << " for writing, checkpoint at time " << time << " skipped" << std::endl;
+        return;
+    }
+
+    int written = MPI_File_set_size(fh, (MPI_Offset) CHECKPOINT_HEADER * sizeof(long long)
+                                      + (MPI_Offset) NX * NY * NZ * (2*Q + 4) * sizeof(double)) == MPI_SUCCESS;
+
+    if(myid == 0)
+    {
+        long long header[CHECKPOINT_HEADER];
+        fillHeader(header, time, NX, NY, NZ, Q, dims, u != NULL);
+        written &= MPI_File_write_at(fh, 0, header, CHECKPOINT_HEADER, MPI_LONG_LONG, MPI_STATUS_IGNORE) == MPI_SUCCESS;
+    }
+
+    // the fields are only read (MPI-IO takes non-const buffers)
+    written &= stateIO(fh, true, (double*) f, (double*) f_eq, (double*) rho, (double*) u, (double*) v, (double*) w,
+                       nn, Q, LX, LY, LZ, NX, NY, NZ, x_beg, y_beg, z_beg);
+
+    written &= MPI_File_close(&fh) == MPI_SUCCESS;
+
+    // the file is complete on all ranks: replace the previous checkpoint
+    int all_written;
+    MPI_Allreduce(&written, &all_written, 1, MPI_INT, MPI_MIN, CART_COMM);
+    if(!all_written)
+    {
+        if(myid == 0) std::cout << "ERROR: writing " << temp_name << " failed, " << file_name << " is left unchanged" << std::endl;
+        return;
+    }
+    if(myid == 0)
+    {
+        if(std::rename(temp_name.c_str(), file_name) != 0)
+        {
+            std::cout << "WARNING: could not rename " << temp_name << " to " << file_name << std::endl;
+        }
+    }
+
+    ckpt.written++;
+    ckpt.bytes_written += (long long) LX * LY * LZ * (2*Q + 1 + (u ? 3 : 0)) * sizeof(double)
+                        + (myid == 0 ? CHECKPOINT_HEADER * sizeof(long long) : 0);
+    ckpt.write_time    += MPI_Wtime() - t_beg;
+}
+
+// read the interior of f, f_eq, rho, u, v and w for this rank's part of the lattice (any process grid),
+// f_new gets a copy of f; returns the lattice time of the checkpoint
+// (u, v and w are left alone if the file holds none: ckpt.restart_velocity is false then)
+
+int checkpointRead(checkpoint_stats & ckpt,
+                   const char*      file_name,
+                   const int        nn,
+                   const int        Q,
+                   const int        LX,
+                   const int        LY,
+                   const int        LZ,
+                   const int        NX,
+                   const int        NY,
+                   const int        NZ,
+                   const int        x_beg,
+                   const int        y_beg,
+                   const int        z_beg,
+                   double*          rho,
+                   double*          f,
+                   double*          f_eq,
+                   double*          f_new,
+                   double*          u,
+                   double*          v,
+                   double*          w,
+                   const int        myid,
+                   const MPI_Comm   CART_COMM)
+{
+    double t_beg = MPI_Wtime();
+
+    MPI_File fh;
+    if(MPI_File_open(CART_COMM, file_name, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS)
+    {
+        if(myid == 0) std::cout << "ERROR: cannot open checkpoint " << file_name << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    // the file must hold the same lattice (the process grid may differ)
+    long long header[CHECKPOINT_HEADER];
+    MPI_File_read_at_all(fh, 0, header, CHECKPOINT_HEADER, MPI_LONG_LONG, MPI_STATUS_IGNORE);
+
+    if(header[0] != CHECKPOINT_MAGIC || header[1] != CHECKPOINT_VERSION ||
+       header[3] != NX || header[4] != NY || header[5] != NZ || header[6] != Q)
+    {
+        if(myid == 0)
+        {
+            std::cout << "ERROR: checkpoint " << file_name << " does not match this run (version " << header[1]
+                      << ", lattice " << header[3] << " x " << header[4] << " x " << header[5]
+                      << ", Q = " << header[6] << ")" << std::endl;
+        }
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    const bool velocity = header[CHECKPOINT_VELOCITY] != 0;
+    if(!stateIO(fh, false, f, f_eq, rho, velocity ? u : NULL, velocity ? v : NULL, velocity ? w : NULL,
+                nn, Q, LX, LY, LZ, NX, NY, NZ, x_beg, y_beg, z_beg))
+    {
+        std::cout << "ERROR: rank " << myid << " cannot read checkpoint " << file_name << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    MPI_File_close(&fh);
+
+    // streaming only writes interior nodes of f_new: it starts out like f (ghost layers are exchanged next)
+    const long long size2 = strideX(nn, LX) * strideY(nn, LX, LY) * (nn+LZ+nn) * (long long) Q;
+    for(long long f_index = 0; f_index < size2; f_index++)
+    {
+        f_new[f_index] = f[f_index];
+    }
+
+    ckpt.restarted       = true;
+    ckpt.restart_time    = (int) header[2];
+    ckpt.restart_dims[0] = (int) header[7];
+    ckpt.restart_dims[1] = (int) header[8];
+    ckpt.restart_dims[2] = (int) header[9];
+    ckpt.restart_velocity = velocity;
+    ckpt.bytes_read     += (long long) LX * LY * LZ * (2*Q + 1 + (u && velocity ? 3 : 0)) * sizeof(double);
+    ckpt.read_time      += MPI_Wtime() - t_beg;
+
+    return ckpt.restart_time;
+}
+
+// print checkpoint and restart throughput (bytes summed over ranks, time of the slowest rank)
+
+void checkpointReport(const checkpoint_stats & ckpt,
+                      const int                interval,
+                      const int*               dims,
+                      const int                myid,
+                      const MPI_Comm           CART_COMM)
+{
+    long long local_bytes[2] = {ckpt.bytes_written, ckpt.bytes_read};
+    long long total_bytes[2];
+    double    local_times[2] = {ckpt.write_time, ckpt.read_time};
+    double    max_times[2];
+    MPI_Reduce(local_bytes, total_bytes, 2, MPI_LONG_LONG, MPI_SUM, 0, CART_COMM);
+    MPI_Reduce(local_times, max_times,   2, MPI_DOUBLE,    MPI_MAX, 0, CART_COMM);
+
+    if(myid != 0) return;
+    if(interval <= 0 && !ckpt.restarted) return;
+
+    const double MB = 1024.0 * 1024.0;
+
+    std::cout << std::endl;
+    if(ckpt.restarted)
+    {
+        std::cout << "restarted from          : time " << ckpt.restart_time << ", written on "
+                  << ckpt.restart_dims[0] << " x " << ckpt.restart_dims[1] << " x " << ckpt.restart_dims[2]
+                  << " ranks, read on " << dims[0] << " x " << dims[1] << " x " << dims[2]
+                  << (ckpt.restart_velocity ? "" : " (no u, v, w in the file)") << std::endl;
+        std::cout << "restart read            : " << total_bytes[1] / MB << " MB in " << max_times[1] << " s ("
+                  << (max_times[1] > 0. ? total_bytes[1] / MB / max_times[1] : 0.) << " MB/s, slowest rank)" << std::endl;
+    }
+    std::cout << "checkpoints             : " << ckpt.written << " (every " << interval << " steps)" << std::endl;
+    if(ckpt.written > 0)
+    {
+        std::cout << "checkpoint write        : " << total_bytes[0] / MB << " MB in " << max_times[0] << " s ("
+                  << (max_times[0] > 0. ? total_bytes[0] / MB / max_times[0] : 0.) << " MB/s, slowest rank)" << std::endl;
+    }
+}
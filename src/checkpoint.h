@@ -0,0 +1,33 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdio>     // std::rename
+#include <mpi.h>      // MPI header files
+
+// complete solver state in one binary file, written and read collectively with MPI-IO
+//
+// the file holds the global f, f_eq, rho, u, v and w arrays (interior nodes in global index order) and
+// the lattice time, so a run can be restarted on any number of ranks and any process grid
+
+const long long CHECKPOINT_MAGIC    = 0x504B484344334353LL;   // "SC3DCHKP"
+const long long CHECKPOINT_VERSION  = 4;
+const int       CHECKPOINT_HEADER   = 16;                     // long long values before the global arrays
+const int       CHECKPOINT_VELOCITY = 10;                     // header entry: 1 if u, v and w were stored, 0 if they are zeros
+
+struct checkpoint_stats
+{
+    int       written;        // checkpoints written
+    long long bytes_written;  // bytes written by this rank
+    double    write_time;     // time spent writing checkpoints
+    bool      restarted;      // the run was started from a checkpoint
+    int       restart_time;   // ... at this lattice time
+    int       restart_dims[3];// ... written on this process grid
+    bool      restart_velocity;// ... by a run that stored u, v and w
+    long long bytes_read;     // bytes read by this rank on restart
+    double    read_time;      // time spent reading the restart file
+};
+
+#endif
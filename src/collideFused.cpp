@@ -0,0 +1,122 @@
+//    fused force, macroscopic update and equilibrium for the low-memory mode
+//    (calc_dPdt + updateMacro + updateEquilibrium without the u, v, w and dPdt fields)
+
+      #include "calc_dPdt.h"
+      #include "nonTemporal.h"   // streaming stores, traffic counters
+
+      extern void psiArray(const double* rho, double* out, const long long count);   // effective density (see calc_dPdt.cpp)
+
+/**
+Per interior node this evaluates the cohesive force with the calc_dPdt
+stencil, takes rho and the forced velocity from the PDFs of the previous step
+(as updateMacro does) and writes rho and f_eq (as updateEquilibrium does).
+Velocity and force stay in registers, so neither is stored.
+
+rho is overwritten in place. The force at plane K needs the old rho of planes
+K-1, K and K+1; their psi values sit in a ring of three XY-planes, and plane
+K+1 is filled before plane K is updated, so no node ever reads an updated
+density.
+*/
+
+      void collideFused(const int nn, const int NX, const int NY, const int NZ,
+                        double* ex, double* ey, double* ez, double* wt, double* G11,
+                        double tau,
+                        double* rho, double* f, double* f_eq)
+      {
+        std::chrono::steady_clock::time_point t_beg = std::chrono::steady_clock::now();
+
+        const long long GX = strideX(nn, NX);
+        const long long GY = strideY(nn, NX, NY);
+        const long long plane = GX*GY;
+
+        // f_eq is only written here (see nonTemporal.cpp)
+        const long long interior = (long long) NX*NY*NZ;
+        const bool streamed = streamingStores(19*interior * (long long) sizeof(double));
+        double *row = streamed ? storeRow(19*(long long) NX) : NULL;
+
+        // ring of three psi planes (old density)
+        double *psi_win = (double*) workspace(WORKSPACE_PSI_PLANES, 3*plane * sizeof(double));
+        auto fillPlane = [&](const int K)
+        {
+          psiArray(rho + K*plane, psi_win + (K % 3)*plane, plane);
+        };
+
+        fillPlane(nn - 1);
+        fillPlane(nn);
+
+        for(int k = 0; k < NZ; k++)
+        {
+          int K = nn + k;
+          fillPlane(K + 1);
+
+          // stencil offsets into the ring as seen from plane K
+          long long offset[19];
+          for(int id = 0; id < 19; id++)
+          {
+            offset[id] = ((K + (int) ez[id]) % 3)*plane + (long long) ey[id]*GX + (long long) ex[id];
+          }
+          const double *psi_K = psi_win + (K % 3)*plane;
+
+          for(int j = 0; j < NY; j++)
+          {
+            int J = nn + j;
+            long long N0 = nn + GX*J + plane*K;
+            double *dst = streamed ? row : f_eq + 19*N0;   // destination of this row's PDFs
+            for(int i = 0; i < NX; i++)
+            {
+              int I = nn + i;
+              long long N = I + GX*J + plane*K;
+              long long P = I + GX*J;   // position inside a psi plane
+
+              // interparticle forces
+              double psi_N = psi_K[P];
+              double Gsumx = 0.;
+              double Gsumy = 0.;
+              double Gsumz = 0.;
+              for(int id = 0; id < 19; id++)
+              {
+                double strength = psi_N * psi_win[offset[id] + P] * G11[id];
+
+                Gsumx += strength * ex[id];
+                Gsumy += strength * ey[id];
+                Gsumz += strength * ez[id];
+              }
+
+              // density and velocity
+              double f_sum = 0;
+              double fex_sum = 0;
+              double fey_sum = 0;
+              double fez_sum = 0;
+              for(int id = 0; id < 19; id++)
+              {
+                long long f_index = 19*N + id;
+                f_sum   += f[f_index];
+                fex_sum += f[f_index]*ex[id];
+                fey_sum += f[f_index]*ey[id];
+                fez_sum += f[f_index]*ez[id];
+              }
+              double rho_N = f_sum;
+              double u_N = fex_sum / rho_N + tau * (-Gsumx) / rho_N;
+              double v_N = fey_sum / rho_N + tau * (-Gsumy) / rho_N;
+              double w_N = fez_sum / rho_N + tau * (-Gsumz) / rho_N;
+              rho[N] = rho_N;
+
+              // equilibrium PDFs
+              double udotu = u_N*u_N + v_N*v_N + w_N*w_N;
+              for(int id = 0; id < 19; id++)
+              {
+                long long index_f = 19*(N - N0) + id;   // within the row
+                double edotu = ex[id]*u_N + ey[id]*v_N + ez[id]*w_N;
+                dst[index_f] = wt[id] * rho_N
+                             * (1 + 3*edotu
+                                  + 4.5*edotu*edotu - 1.5*udotu);
+              }
+            }
+            if(streamed) streamStore(f_eq + 19*N0, row, 19*(long long) NX);
+          }
+        }
+
+        if(streamed) storeFence();
+        trafficAdd(TRAFFIC_EQUILIBRIUM, t_beg, 19*interior * (long long) sizeof(double),
+                   19*interior * (long long) sizeof(double), streamed);
+      }
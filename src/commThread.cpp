@@ -0,0 +1,140 @@
+#include "commThread.h"
+
+/**
+Communication thread for halo exchanges
+
+Many MPI implementations only make progress on large (rendezvous) messages
+while the application is inside an MPI call. Handing every halo exchange to a
+thread that does nothing but communicate keeps the messages moving while the
+compute thread works on kernels that do not touch the ghost layers.
+
+The compute thread keeps calling MPI while halo exchanges run on the
+communication thread (tuner reductions, frames sent to I/O servers, shared
+file output), so the thread is only started with MPI_THREAD_MULTIPLE. If the
+MPI library does not provide it, or the thread is disabled, posted jobs
+simply run on the calling thread.
+*/
+
+// main loop of the communication thread
+
+static void commThreadLoop(comm_thread * comm)
+{
+    std::unique_lock<std::mutex> lock(comm->mutex);
+
+    while(true)
+    {
+        comm->wake.wait(lock, [comm]{ return comm->stop || !comm->jobs.empty(); });
+
+        if(comm->jobs.empty()) break;   // stop was requested and the queue is drained
+
+        std::function<void()> job = comm->jobs.front();
+        comm->jobs.pop_front();
+
+        lock.unlock();
+        double t_beg = MPI_Wtime();
+        job();
+        double t_job = MPI_Wtime() - t_beg;
+        lock.lock();
+
+        comm->busy_time += t_job;
+        comm->pending--;
+        if(comm->pending == 0) comm->done.notify_all();
+    }
+}
+
+// start the communication thread (if requested and supported by the MPI library)
+
+void commThreadStart(comm_thread & comm,
+                     const bool    enable,            // user wants a communication thread
+                     const int     thread_provided,   // thread support level returned by MPI_Init_thread
+                     const int     myid)              // MPI rank
+{
+    comm.active    = false;
+    comm.stop      = false;
+    comm.pending   = 0;
+    comm.busy_time = 0.;
+    comm.wait_time = 0.;
+
+    if(!enable) return;
+
+    if(thread_provided < MPI_THREAD_MULTIPLE)
+    {
+        if(myid == 0) std::cout << "WARNING: MPI library does not support MPI_THREAD_MULTIPLE, "
+                                << "halo exchanges will run on the compute thread" << std::endl;
+        return;
+    }
+
+    comm.active = true;
+    comm.worker = std::thread(commThreadLoop, &comm);
+}
+
+// hand a halo exchange to the communication thread
+
+void commThreadPost(comm_thread & comm, const std::function<void()> & job)
+{
+    if(!comm.active)
+    {
+        double t_beg = MPI_Wtime();
+        job();
+        double t_job = MPI_Wtime() - t_beg;
+        comm.busy_time += t_job;
+        comm.wait_time += t_job;   // nothing is hidden when the caller does the work
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(comm.mutex);
+    comm.jobs.push_back(job);
+    comm.pending++;
+    comm.wake.notify_one();
+}
+
+// block until every posted halo exchange has completed
+
+void commThreadWait(comm_thread & comm)
+{
+    if(!comm.active) return;
+
+    double t_beg = MPI_Wtime();
+    std::unique_lock<std::mutex> lock(comm.mutex);
+    comm.done.wait(lock, [&comm]{ return comm.pending == 0; });
+    comm.wait_time += MPI_Wtime() - t_beg;
+}
+
+// drain the queue and join the communication thread
+
+void commThreadStop(comm_thread & comm)
+{
+    if(!comm.active) return;
+
+    {
+        std::lock_guard<std::mutex> lock(comm.mutex);
+        comm.stop = true;
+        comm.wake.notify_one();
+    }
+    comm.worker.join();
+    comm.active = false;
+}
+
+// print how much of the halo exchange time was hidden behind computation
+
+void commThreadReport(const comm_thread & comm,
+                      const bool          enable,
+                      const int           myid,
+                      const MPI_Comm      CART_COMM)
+{
+    double local_times[2] = {comm.busy_time, comm.wait_time};
+    double max_times[2];
+    MPI_Reduce(local_times, max_times, 2, MPI_DOUBLE, MPI_MAX, 0, CART_COMM);
+
+    if(myid == 0)
+    {
+        double hidden = max_times[0] - max_times[1];
+        if(hidden < 0.) hidden = 0.;
+        std::cout << std::endl;
+        std::cout << "communication thread    : " << (enable ? "on" : "off") << std::endl;
+        std::cout << "halo exchange time      : " << max_times[0] << " s (slowest rank)" << std::endl;
+        std::cout << "exposed (compute waits) : " << max_times[1] << " s" << std::endl;
+        std::cout << "hidden behind compute   : " << hidden << " s ("
+                  << (max_times[0] > 0. ? 100.0 * hidden / max_times[0] : 0.) << " %)" << std::endl;
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef COMM_THREAD_H
+#define COMM_THREAD_H
+
+#include <iostream>
+#include <thread>               // std::thread
+#include <mutex>                // std::mutex, std::unique_lock
+#include <condition_variable>   // std::condition_variable
+#include <deque>                // std::deque
+#include <functional>           // std::function
+#include <mpi.h>                // MPI header files
+
+// a dedicated thread that owns all halo traffic of this MPI rank
+//
+// the compute thread posts halo exchanges as soon as the data they send is ready
+// and only waits for them right before it needs the ghost layers
+
+struct comm_thread
+{
+    bool                              active;      // false --> posted jobs are executed immediately by the caller
+    bool                              stop;        // tells the thread to finish the queue and exit
+    int                               pending;     // jobs posted but not yet completed
+    std::deque<std::function<void()>> jobs;        // queue of posted halo exchanges
+    std::mutex                        mutex;       // protects all members above
+    std::condition_variable           wake;        // signals the thread that a job was posted
+    std::condition_variable           done;        // signals the compute thread that the queue is empty
+    std::thread                       worker;      // the communication thread itself
+    double                            busy_time;   // time spent executing jobs
+    double                            wait_time;   // time the compute thread spent waiting for jobs (exposed communication)
+};
+
+#endif
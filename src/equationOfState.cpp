@@ -0,0 +1,190 @@
+#include "equationOfState.h"
+
+/**
+Pseudopotential psi(rho) from an equation of state
+
+For a non-ideal EOS p(rho) the pseudopotential follows from the pressure of
+the Shan-Chen model. With the cohesive force used in calc_dPdt (strength G on
+the 6 axis directions and G/2 on the 12 diagonals) that pressure is
+
+   p = rho/3 + 3 G psi^2    -->    psi = sqrt( (p(rho) - rho/3) / (3 G) )
+
+Carnahan-Starling and Peng-Robinson are much more expensive to evaluate than
+the exponential form, so psi can be tabulated once on a uniform grid in rho and
+linearly interpolated. eosPsiArray evaluates a whole array at once with a
+branch-free loop the compiler can vectorize; densities above the table range
+are fixed up afterwards with the exact EOS.
+*/
+
+double eosPsiExact(const eos_table & eos, const double rho);
+
+// pressure p(rho) of the selected EOS
+
+double eosPressure(const eos_table & eos, const double rho)
+{
+    if(eos.model == EOS_CARNAHAN_STARLING)
+    {
+        double x = eos.b * rho / 4.;
+        return rho * eos.R * eos.T * (1. + x + x*x - x*x*x) / ((1. - x)*(1. - x)*(1. - x)) - eos.a * rho*rho;
+    }
+    if(eos.model == EOS_PENG_ROBINSON)
+    {
+        double s     = 1. + (0.37464 + 1.54226*eos.omega - 0.26992*eos.omega*eos.omega) * (1. - sqrt(eos.T / eos.Tc));
+        double alpha = s*s;
+        return rho * eos.R * eos.T / (1. - eos.b * rho)
+             - eos.a * alpha * rho*rho / (1. + 2.*eos.b*rho - eos.b*eos.b*rho*rho);
+    }
+    double psi = eosPsiExact(eos, rho);   // exponential: the pressure follows from psi
+    return rho / 3. + 3. * eos.G * psi * psi;
+}
+
+// psi evaluated directly from the EOS (validation and out-of-range densities)
+
+double eosPsiExact(const eos_table & eos, const double rho)
+{
+    if(eos.model == EOS_EXPONENTIAL)
+    {
+        const double E = 2.71828;   // same constant as the original psi() so results are unchanged
+        const double rho0 = 1.0;
+        return rho0 * (1 - pow(E, -rho/rho0));
+    }
+
+    double arg = (eosPressure(eos, rho) - rho / 3.) / (3. * eos.G);
+    return (arg > 0.) ? sqrt(arg) : 0.;
+}
+
+// psi from the table (or the exact EOS if there is no table or rho lies outside it)
+
+double eosPsi(const eos_table & eos, const double rho)
+{
+    if(!eos.use_table || rho < 0. || rho >= eos.rho_max) return eosPsiExact(eos, rho);
+
+    // rho just below rho_max can round to the last table entry: use the last interval then
+    const int last = (int) eos.psi.size() - 2;
+
+    double x = rho * eos.inv_drho;
+    int    n = (int) x;
+    if(n > last) n = last;
+    double t = x - n;
+    return eos.psi[n] + t * (eos.psi[n+1] - eos.psi[n]);
+}
+
+// psi for "count" densities at once
+
+void eosPsiArray(const eos_table & eos, const double* rho, double* psi, const long long count)
+{
+    if(!eos.use_table)
+    {
+        for(long long n = 0; n < count; n++) psi[n] = eosPsiExact(eos, rho[n]);
+        return;
+    }
+
+    const double *table = eos.psi.data();
+    const double  x_max = (double) (eos.psi.size() - 1) * (1. - 1.e-12);
+    long long outside = 0;
+
+    // clamp into the table, no branches inside the loop
+    #pragma omp simd reduction(+:outside)
+    for(long long n = 0; n < count; n++)
+    {
+        double x  = rho[n] * eos.inv_drho;
+        double xc = (x < 0.) ? 0. : ((x > x_max) ? x_max : x);
+        int    m  = (int) xc;
+        double t  = xc - m;
+        psi[n]    = table[m] + t * (table[m+1] - table[m]);
+        outside  += (x != xc);
+    }
+
+    if(outside > 0)
+    {
+        for(long long n = 0; n < count; n++)
+        {
+            if(rho[n] < 0. || rho[n] >= eos.rho_max) psi[n] = eosPsiExact(eos, rho[n]);
+        }
+    }
+}
+
+// choose the EOS and build the table
+
+void eosSetup(eos_table  & eos,
+              const int    model,        // one of EOS_*
+              const double G,            // interaction strength (GEE11)
+              const double T_ratio,      // temperature as a fraction of the critical temperature
+              const bool   use_table,    // interpolate psi from a table
+              const int    table_size,   // number of table entries
+              const double rho_max)      // largest density covered by the table
+{
+    eos.model = model;
+    eos.G     = G;
+    eos.omega = 0.;
+    eos.R     = 1.;
+
+    if(model == EOS_CARNAHAN_STARLING)
+    {
+        eos.a  = 1.;
+        eos.b  = 4.;
+        eos.Tc = 0.3773 * eos.a / (eos.b * eos.R);
+    }
+    else if(model == EOS_PENG_ROBINSON)
+    {
+        eos.a     = 2. / 49.;
+        eos.b     = 2. / 21.;
+        eos.omega = 0.344;
+        eos.Tc    = 0.0778 * eos.a / (0.45724 * eos.b * eos.R);
+    }
+    else
+    {
+        eos.a  = 0.;
+        eos.b  = 0.;
+        eos.Tc = 1.;
+    }
+    eos.T = T_ratio * eos.Tc;
+
+    // both EOS diverge at close packing (rho = 4/b and rho = 1/b), keep the table below that
+    double rho_limit = rho_max;
+    if(model == EOS_CARNAHAN_STARLING) rho_limit = 0.99 * 4. / eos.b;
+    if(model == EOS_PENG_ROBINSON)     rho_limit = 0.99 / eos.b;
+
+    eos.use_table = use_table && table_size > 1;
+    eos.rho_max   = std::min(rho_max, rho_limit);
+    eos.inv_drho  = (table_size - 1) / eos.rho_max;
+    eos.psi.clear();
+    if(eos.use_table)
+    {
+        eos.psi.resize(table_size);
+        for(int n = 0; n < table_size; n++) eos.psi[n] = eosPsiExact(eos, n / eos.inv_drho);
+    }
+}
+
+// validate the table against the exact EOS and compare the cost of both paths
+
+void eosReport(const eos_table & eos, const int myid)
+{
+    if(myid != 0) return;
+
+    const char* names[] = {"exponential", "Carnahan-Starling", "Peng-Robinson"};
+    std::cout << std::endl;
+    std::cout << "equation of state       : " << names[eos.model];
+    if(eos.model != EOS_EXPONENTIAL) std::cout << " (T/Tc = " << eos.T / eos.Tc << ")";
+    std::cout << std::endl;
+    if(!eos.use_table) return;
+
+    // densities spread over the table range, deliberately off the table nodes
+    const int count = 1 << 16;
+    std::vector<double> rho(count), exact(count), table(count);
+    for(int n = 0; n < count; n++) rho[n] = eos.rho_max * (n + 0.37) / count;
+
+    double t0 = MPI_Wtime();
+    for(int n = 0; n < count; n++) exact[n] = eosPsiExact(eos, rho[n]);
+    double t1 = MPI_Wtime();
+    eosPsiArray(eos, rho.data(), table.data(), count);
+    double t2 = MPI_Wtime();
+
+    double max_error = 0.;
+    for(int n = 0; n < count; n++) max_error = std::max(max_error, fabs(table[n] - exact[n]));
+
+    std::cout << "psi lookup table        : " << eos.psi.size() << " entries for 0 <= rho < " << eos.rho_max
+              << ", max. error " << max_error << std::endl;
+    std::cout << "cost per psi value      : " << 1.e9 * (t1 - t0) / count << " ns exact, "
+              << 1.e9 * (t2 - t1) / count << " ns table" << std::endl;
+}
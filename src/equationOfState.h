@@ -0,0 +1,36 @@
+#ifndef EQUATION_OF_STATE_H
+#define EQUATION_OF_STATE_H
+
+#include <iostream>
+#include <vector>
+#include <algorithm>  // std::min, std::max
+#include <cmath>      // pow, exp, sqrt
+#include <mpi.h>      // MPI_Wtime
+
+// equations of state available for the Shan-Chen pseudopotential psi(rho)
+
+enum
+{
+    EOS_EXPONENTIAL       = 0,   // original Shan-Chen form psi = rho0 * (1 - exp(-rho/rho0))
+    EOS_CARNAHAN_STARLING = 1,   // Carnahan-Starling hard-sphere EOS (a = 1, b = 4, R = 1)
+    EOS_PENG_ROBINSON     = 2    // Peng-Robinson EOS (a = 2/49, b = 2/21, R = 1, omega = 0.344)
+};
+
+// EOS parameters and the (optional) lookup table for psi
+
+struct eos_table
+{
+    int     model;       // one of EOS_*
+    double  G;           // interaction strength (GEE11) used to turn p(rho) into psi(rho)
+    double  a, b, R;     // EOS constants
+    double  omega;       // acentric factor (Peng-Robinson)
+    double  T;           // temperature
+    double  Tc;          // critical temperature of the EOS
+
+    bool    use_table;   // interpolate psi from the table instead of evaluating the EOS
+    double  rho_max;     // table covers 0 <= rho <= rho_max
+    double  inv_drho;    // 1 / table spacing
+    std::vector<double> psi;   // psi at rho = n / inv_drho, n = 0 .. size-1
+};
+
+#endif
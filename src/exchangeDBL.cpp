@@ -26,20 +26,26 @@ void exchangeDBL  (const int      & nn,                // number of ghost cell l
     const int MXP = nn+MX+nn;     
     const int MYP = nn+MY+nn;     
     const int MZP = nn+MZ+nn;     
+
+    // strides of the color buffer (rows and planes may be padded beyond MXP and MYP)
+    const long long SX = strideX(nn, MX);
+    const long long SY = strideY(nn, MX, MY);
      
     // for communicating non-contiguous values in the color buffer 
     // these values are located in the YZ plane and communicated along X
-    MPI_Datatype stridex;
-    MPI_Type_vector( (MYP)*(MZP), 1, MXP, MPI_DOUBLE, &stridex);
+    MPI_Datatype columnx, stridex;
+    MPI_Type_vector( MYP, 1, SX, MPI_DOUBLE, &columnx);
+    MPI_Type_create_hvector( MZP, 1, SX*SY*sizeof(double), columnx, &stridex);
     MPI_Type_commit( &stridex);
+    MPI_Type_free( &columnx);
 
     // for communicating non-contiguous values in the color buffer
     // these values are located in the XZ plane and communicated along Y
     MPI_Datatype stridey;
-    MPI_Type_vector( MZP, MXP, (MYP)*(MXP), MPI_DOUBLE, &stridey);
+    MPI_Type_vector( MZP, MXP, SX*SY, MPI_DOUBLE, &stridey);
     MPI_Type_commit( &stridey);
 
-    // total number of values in a XY plane (contiguous values)
+    // values in a XY plane, communicated along Z (contiguous unless the rows are padded)
     //
     // example layout for the case nn = 1 (1 layer of ghost cells)
     //          
@@ -66,7 +72,9 @@ void exchangeDBL  (const int      & nn,                // number of ghost cell l
     //         0,0     1,0     2,0     3,0     ...    MX,0    MX+1,0
     //
     //
-    int no_xy = (MXP)*(MYP);
+    MPI_Datatype stridez;
+    MPI_Type_vector( MYP, MXP, SX, MPI_DOUBLE, &stridez);
+    MPI_Type_commit( &stridez);
 
     // loop over the number of ghost layers
     for(int i = 0; i < nn; i++)
@@ -93,17 +101,17 @@ void exchangeDBL  (const int      & nn,                // number of ghost cell l
             int ry = 0;
             int rz = (nn - 1) - i;
 
-            int send = sx + sy * (MXP) + sz * (MXP)*(MYP);  // send the topmost (non-ghost) layer of data
-            int recv = rx + ry * (MXP) + rz * (MXP)*(MYP);  // receive data into the bottom ghost cell layer
+            long long send = sx + sy * SX + sz * SX*SY;  // send the topmost (non-ghost) layer of data
+            long long recv = rx + ry * SX + rz * SX*SY;  // receive data into the bottom ghost cell layer
 
             MPI_Sendrecv(&color[send],       // send buffer (points to the starting address of the data chunk)
-                         no_xy,              // number of elements to be sent
-                         MPI_DOUBLE,         // type of elements
+                         1,                  // number of elements to be sent
+                         stridez,            // type of elements
                          nbr_TOP,            // destination (where the data is going)
                          111,                // tag
                          &color[recv],       // receive buffer (points to the starting address of the data chunk)
-                         no_xy,              // number of elements received
-                         MPI_DOUBLE,         // type of elements
+                         1,                  // number of elements received
+                         stridez,            // type of elements
                          nbr_BOTTOM,         // source (where the data is coming from)
                          111,                // tag
                          CART_COMM,          // MPI Communicator used for this Sendrecv
@@ -132,17 +140,17 @@ void exchangeDBL  (const int      & nn,                // number of ghost cell l
             int ry = 0;
             int rz = nn + MZ + i;
 
-            int send = sx + sy * (MXP) + sz * (MXP)*(MYP); // send the bottommost (non-ghost) layer of data
-            int recv = rx + ry * (MXP) + rz * (MXP)*(MYP); // receive data into the top ghost cell layer
+            long long send = sx + sy * SX + sz * SX*SY; // send the bottommost (non-ghost) layer of data
+            long long recv = rx + ry * SX + rz * SX*SY; // receive data into the top ghost cell layer
 
             MPI_Sendrecv(&color[send],       // send buffer (points to the starting address of the data chunk) 
-                         no_xy,              // number of elements to be sent
-                         MPI_DOUBLE,         // type of elements
+                         1,                  // number of elements to be sent
+                         stridez,            // type of elements
                          nbr_BOTTOM,         // destination (where the data is going)
                          222,                // tag
                          &color[recv],       // receive buffer (points to the starting address of the data chunk)
-                         no_xy,              // number of elements received
-                         MPI_DOUBLE,         // type of elements
+                         1,                  // number of elements received
+                         stridez,            // type of elements
                          nbr_TOP,            // source (where the data is coming from)
                          222,                // tag
                          CART_COMM,          // MPI Communicator used for this Sendrecv
@@ -171,8 +179,8 @@ void exchangeDBL  (const int      & nn,                // number of ghost cell l
             int ry = 0;
             int rz = 0;
 
-            int send = sx + sy * (MXP) + sz * (MXP)*(MYP);  // send the topmost (non-ghost) layer of data
-            int recv = rx + ry * (MXP) + rz * (MXP)*(MYP);  // receive data into the bottom ghost cell layer
+            long long send = sx + sy * SX + sz * SX*SY;  // send the topmost (non-ghost) layer of data
+            long long recv = rx + ry * SX + rz * SX*SY;  // receive data into the bottom ghost cell layer
 
             MPI_Sendrecv(&color[send],       // send buffer (points to the starting address of the data chunk) 
                          1,                  // number of elements to be sent
@@ -210,8 +218,8 @@ void exchangeDBL  (const int      & nn,                // number of ghost cell l
             int ry = 0;
             int rz = 0;
 
-            int send = sx + sy * (MXP) + sz * (MXP)*(MYP); // send the bottommost (non-ghost) layer of data
-            int recv = rx + ry * (MXP) + rz * (MXP)*(MYP); // receive data into the top ghost cell layer
+            long long send = sx + sy * SX + sz * SX*SY; // send the bottommost (non-ghost) layer of data
+            long long recv = rx + ry * SX + rz * SX*SY; // receive data into the top ghost cell layer
 
             MPI_Sendrecv(&color[send],       // send buffer (points to the starting address of the data chunk) 
                          1,                  // number of elements to be sent
@@ -249,8 +257,8 @@ void exchangeDBL  (const int      & nn,                // number of ghost cell l
             int ry = (nn - 1) - i;
             int rz = 0;
 
-            int send = sx + sy * (MXP) + sz * (MXP)*(MYP); // send the southernmost (non-ghost) layer of data
-            int recv = rx + ry * (MXP) + rz * (MXP)*(MYP); // receive data into the north ghost cell layer
+            long long send = sx + sy * SX + sz * SX*SY; // send the southernmost (non-ghost) layer of data
+            long long recv = rx + ry * SX + rz * SX*SY; // receive data into the north ghost cell layer
 
             MPI_Sendrecv(&color[send],       // send buffer (points to the starting address of the data chunk) 
                          1,                  // number of elements to be sent
@@ -288,8 +296,8 @@ void exchangeDBL  (const int      & nn,                // number of ghost cell l
             int ry = nn + MY + i;
             int rz = 0;
 
-            int send = sx + sy * (MXP) + sz * (MXP)*(MYP); // send the southernmost (non-ghost) layer of data
-            int recv = rx + ry * (MXP) + rz * (MXP)*(MYP); // receive data into the north ghost cell layer
+            long long send = sx + sy * SX + sz * SX*SY; // send the southernmost (non-ghost) layer of data
+            long long recv = rx + ry * SX + rz * SX*SY; // receive data into the north ghost cell layer
 
             MPI_Sendrecv(&color[send],       // send buffer (points to the starting address of the data chunk) 
                          1,                  // number of elements to be sent
@@ -310,4 +318,5 @@ void exchangeDBL  (const int      & nn,                // number of ghost cell l
     // cleanup
     MPI_Type_free(&stridex);
     MPI_Type_free(&stridey);
+    MPI_Type_free(&stridez);
 }
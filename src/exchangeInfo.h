@@ -4,4 +4,68 @@
 #include <iostream>
 #include <mpi.h>      // MPI header files
 
+#include "haloCodec.h"
+
+// one face of the partitioned PDF halo exchange
+//
+// every PDF direction is a separate partition of the message, so a direction can
+// leave the node as soon as the thread packing it is done
+
+struct halo_face
+{
+    int          dest;          // rank the boundary layer is sent to
+    int          source;        // rank the ghost layer is received from
+    int          tag;           // message tag
+    int          send_x0;       // origin of the first boundary layer being sent
+    int          send_y0;
+    int          send_z0;
+    int          recv_x0;       // origin of the first ghost layer being received
+    int          recv_y0;
+    int          recv_z0;
+    int          nx;            // size of one layer along X, Y and Z
+    int          ny;
+    int          nz;
+    int          layer_step;    // offset between successive layers (-1 or +1 along the normal)
+    int          normal;        // 0 = X, 1 = Y, 2 = Z
+    int          partition;     // values per partition (one PDF direction, all ghost layers)
+    double     * send_buf;      // Q partitions of packed boundary values
+    double     * recv_buf;      // Q partitions of received ghost values
+    MPI_Request  send_req;      // partitioned requests (MPI-4)
+    MPI_Request  recv_req;
+    MPI_Request *send_reqs;     // one persistent request per partition (MPI-3 fallback)
+    MPI_Request *recv_reqs;
+};
+
+// persistent state for partitioned exchanges of one PDF array layout
+
+struct pdf_halo_plan
+{
+    int        nn;              // number of ghost cell layers
+    int        Q;               // number of LBM streaming directions (= partitions per message)
+    int        MXP;             // padded voxels along X
+    int        MYP;             // padded voxels along Y
+    int        MZP;             // padded voxels along Z
+    long long  SX;              // row stride of the 4D array (nodes, padding included)
+    long long  SY;              // rows per plane of the 4D array
+    int        thread_level;    // thread support provided by the MPI library
+    halo_face  face[6];         // TOP, BOTTOM, EAST, WEST, NORTH, SOUTH (exchanged in pairs)
+};
+
+// encode, exchange and decode one face of a PDF direction (see haloCodec.cpp)
+
+extern void haloSendrecv(halo_codec & codec,
+                         double     * PDF3d,      // 3D array (one PDF direction, ghost layers included)
+                         const long long send,    // first index of the box to be sent
+                         const long long recv,    // first index of the box to be received
+                         const int    nx,         // box size along X
+                         const int    ny,         // box size along Y
+                         const int    nz,         // box size along Z
+                         const int    MXP,        // padded voxels along X
+                         const int    MYP,        // padded voxels along Y
+                         const int    dest,       // destination (where the data is going)
+                         const int    sendtag,    // tag for the outgoing message
+                         const int    source,     // source (where the data is coming from)
+                         const int    recvtag,    // tag for the incoming message
+                         const MPI_Comm CART_COMM);
+
 #endif
@@ -21,20 +21,27 @@ void exchangePDF (const int      nn,                // number of ghost cell laye
                   const int      nbr_NORTH,         // process id of my northern neighbor
                   const int      nbr_BOTTOM,        // process id of my bottom neighbor
                   const int      nbr_TOP,           // process id of my top neighbor
-                     double      *PDF4d)             // pointer to the 4D array being exchanged (of type double)
+                     double      *PDF4d,             // pointer to the 4D array being exchanged (of type double)
+                  halo_codec     &codec)             // encoding used for the halo messages (and exchange statistics)
 {
     MPI_Status status;
 
+    double t_beg = MPI_Wtime();
+
     const int MXP = nn+MX+nn;  // padded voxels along X
     const int MYP = nn+MY+nn;  // padded voxels along Y
     const int MZP = nn+MZ+nn;  // padded voxels along Z
 
+    // strides of PDF4d (rows and planes may be padded beyond MXP and MYP)
+    const long long SX = strideX(nn, MX);
+    const long long SY = strideY(nn, MX, MY);
+
     // regular voxels + voxels in the ghost layer
-    const int PADDED_VOXELS = MXP*MYP*MZP;
+    const long long PADDED_VOXELS = (long long) MXP*MYP*MZP;
 
     // allocate a 3D array for storing f(a)
-    // ghost layers are included in this 3D array
-    double *PDF3d = new double[PADDED_VOXELS]; 
+    // ghost layers are included in this 3D array (padding is not)
+    double *PDF3d = (double*) workspace(WORKSPACE_PDF3D, PADDED_VOXELS * sizeof(double));
 
     // loop for all PDF directions
     for (int a = 0; a < Q; a++)
@@ -45,10 +52,10 @@ void exchangePDF (const int      nn,                // number of ghost cell laye
                 for(int k = 0; k < MZP; k++) {
 
                     // natural index for fa(i,j,k) in PDF3d
-                    int index_3d = i + j*MXP + k*MXP*MYP;
+                    long long index_3d = i + j*MXP + (long long) k*MXP*MYP;
 
                     // natural index for f(i,j,k,a) in PDF4d
-                    int index_4d = a + (index_3d * Q);
+                    long long index_4d = a + (i + j*SX + k*SX*SY) * Q;
 
                     // PDF3d <---- PDF4d(a)
                     PDF3d[index_3d] = PDF4d[index_4d];
@@ -121,21 +128,29 @@ void exchangePDF (const int      nn,                // number of ghost cell laye
             int ry = 0;
             int rz = (nn - 1) - i;
 
-            int send = sx + sy * MXP + sz * MXP*MYP;  // send the topmost (non-ghost) layer of data
-            int recv = rx + ry * MXP + rz * MXP*MYP;  // receive data into the bottom ghost cell layer
-
-            MPI_Sendrecv(&PDF3d[send],       // send buffer (points to the starting address of the data chunk)
-                         no_xy,              // number of elements to be sent
-                         MPI_DOUBLE,         // type of elements
-                         nbr_TOP,            // destination (where the data is going)
-                         111,                // tag
-                         &PDF3d[recv],       // receive buffer (points to the starting address of the data chunk)
-                         no_xy,              // number of elements received
-                         MPI_DOUBLE,         // type of elements
-                         nbr_BOTTOM,         // source (where the data is coming from)
-                         111,                // tag
-                         CART_COMM,          // MPI Communicator used for this Sendrecv
-                         &status);           // MPI status
+            long long send = sx + sy * MXP + (long long) sz * MXP*MYP;  // send the topmost (non-ghost) layer of data
+            long long recv = rx + ry * MXP + (long long) rz * MXP*MYP;  // receive data into the bottom ghost cell layer
+
+            if(codec.mode == HALO_CODEC_NONE)
+            {
+                MPI_Sendrecv(&PDF3d[send],       // send buffer (points to the starting address of the data chunk)
+                             no_xy,              // number of elements to be sent
+                             MPI_DOUBLE,         // type of elements
+                             nbr_TOP,            // destination (where the data is going)
+                             111,                // tag
+                             &PDF3d[recv],       // receive buffer (points to the starting address of the data chunk)
+                             no_xy,              // number of elements received
+                             MPI_DOUBLE,         // type of elements
+                             nbr_BOTTOM,         // source (where the data is coming from)
+                             111,                // tag
+                             CART_COMM,          // MPI Communicator used for this Sendrecv
+                             &status);           // MPI status
+            }
+            else
+            {
+                haloSendrecv(codec, PDF3d, send, recv, MXP, MYP, 1, MXP, MYP,
+                             nbr_TOP, 111, nbr_BOTTOM, 111, CART_COMM);
+            }
         }
 
         // I am sending PDF3d data to the process nbr_BOTTOM and receiving PDF3d data from the process nbr_TOP
@@ -160,21 +175,29 @@ void exchangePDF (const int      nn,                // number of ghost cell laye
             int ry = 0;
             int rz = nn + MZ + i;
 
-            int send = sx + sy * MXP + sz * MXP*MYP; // send the bottommost (non-ghost) layer of data
-            int recv = rx + ry * MXP + rz * MXP*MYP; // receive data into the top ghost cell layer
-
-            MPI_Sendrecv(&PDF3d[send],       // send buffer (points to the starting address of the data chunk) 
-                         no_xy,              // number of elements to be sent
-                         MPI_DOUBLE,         // type of elements
-                         nbr_BOTTOM,         // destination (where the data is going)
-                         222,                // tag
-                         &PDF3d[recv],       // receive buffer (points to the starting address of the data chunk)
-                         no_xy,              // number of elements received
-                         MPI_DOUBLE,         // type of elements
-                         nbr_TOP,            // source (where the data is coming from)
-                         222,                // tag
-                         CART_COMM,          // MPI Communicator used for this Sendrecv
-                         &status);           // MPI status
+            long long send = sx + sy * MXP + (long long) sz * MXP*MYP; // send the bottommost (non-ghost) layer of data
+            long long recv = rx + ry * MXP + (long long) rz * MXP*MYP; // receive data into the top ghost cell layer
+
+            if(codec.mode == HALO_CODEC_NONE)
+            {
+                MPI_Sendrecv(&PDF3d[send],       // send buffer (points to the starting address of the data chunk) 
+                             no_xy,              // number of elements to be sent
+                             MPI_DOUBLE,         // type of elements
+                             nbr_BOTTOM,         // destination (where the data is going)
+                             222,                // tag
+                             &PDF3d[recv],       // receive buffer (points to the starting address of the data chunk)
+                             no_xy,              // number of elements received
+                             MPI_DOUBLE,         // type of elements
+                             nbr_TOP,            // source (where the data is coming from)
+                             222,                // tag
+                             CART_COMM,          // MPI Communicator used for this Sendrecv
+                             &status);           // MPI status
+            }
+            else
+            {
+                haloSendrecv(codec, PDF3d, send, recv, MXP, MYP, 1, MXP, MYP,
+                             nbr_BOTTOM, 222, nbr_TOP, 222, CART_COMM);
+            }
         }
 
         // I am sending PDF3d data to the process nbr_EAST and receiving PDF3d data from process nbr_WEST
@@ -199,21 +222,29 @@ void exchangePDF (const int      nn,                // number of ghost cell laye
             int ry = 0;
             int rz = 0;
 
-            int send = sx + sy * MXP + sz * MXP*MYP; // send the bottommost (non-ghost) layer of data
-            int recv = rx + ry * MXP + rz * MXP*MYP; // receive data into the top ghost cell layer
-
-            MPI_Sendrecv(&PDF3d[send],       // send buffer (points to the starting address of the data chunk) 
-                         1,                  // number of elements to be sent
-                         stridex,            // type of elements
-                         nbr_EAST,           // destination (where the data is going)
-                         333,                // tag
-                         &PDF3d[recv],       // receive buffer (points to the starting address of the data chunk)
-                         1,                  // number of elements received
-                         stridex,            // type of elements
-                         nbr_WEST,           // source (where the data is coming from)
-                         333,                // tag
-                         CART_COMM,          // MPI Communicator used for this Sendrecv
-                         &status);           // MPI status
+            long long send = sx + sy * MXP + (long long) sz * MXP*MYP; // send the bottommost (non-ghost) layer of data
+            long long recv = rx + ry * MXP + (long long) rz * MXP*MYP; // receive data into the top ghost cell layer
+
+            if(codec.mode == HALO_CODEC_NONE)
+            {
+                MPI_Sendrecv(&PDF3d[send],       // send buffer (points to the starting address of the data chunk) 
+                             1,                  // number of elements to be sent
+                             stridex,            // type of elements
+                             nbr_EAST,           // destination (where the data is going)
+                             333,                // tag
+                             &PDF3d[recv],       // receive buffer (points to the starting address of the data chunk)
+                             1,                  // number of elements received
+                             stridex,            // type of elements
+                             nbr_WEST,           // source (where the data is coming from)
+                             333,                // tag
+                             CART_COMM,          // MPI Communicator used for this Sendrecv
+                             &status);           // MPI status
+            }
+            else
+            {
+                haloSendrecv(codec, PDF3d, send, recv, 1, MYP, MZP, MXP, MYP,
+                             nbr_EAST, 333, nbr_WEST, 333, CART_COMM);
+            }
         }
 
         // I am sending PDF3d data to the process nbr_WEST and receiving PDF3d data from process nbr_EAST
@@ -238,21 +269,29 @@ void exchangePDF (const int      nn,                // number of ghost cell laye
             int ry = 0;
             int rz = 0;
 
-            int send = sx + sy * MXP + sz * MXP*MYP; // send the bottommost (non-ghost) layer of data
-            int recv = rx + ry * MXP + rz * MXP*MYP; // receive data into the top ghost cell layer
-
-            MPI_Sendrecv(&PDF3d[send],       // send buffer (points to the starting address of the data chunk) 
-                         1,                  // number of elements to be sent
-                         stridex,            // type of elements
-                         nbr_WEST,           // destination (where the data is going)
-                         444,                // tag
-                         &PDF3d[recv],       // receive buffer (points to the starting address of the data chunk)
-                         1,                  // number of elements received
-                         stridex,            // type of elements
-                         nbr_EAST,           // source (where the data is coming from)
-                         444,                // tag
-                         CART_COMM,          // MPI Communicator used for this Sendrecv
-                         &status);           // MPI status
+            long long send = sx + sy * MXP + (long long) sz * MXP*MYP; // send the bottommost (non-ghost) layer of data
+            long long recv = rx + ry * MXP + (long long) rz * MXP*MYP; // receive data into the top ghost cell layer
+
+            if(codec.mode == HALO_CODEC_NONE)
+            {
+                MPI_Sendrecv(&PDF3d[send],       // send buffer (points to the starting address of the data chunk) 
+                             1,                  // number of elements to be sent
+                             stridex,            // type of elements
+                             nbr_WEST,           // destination (where the data is going)
+                             444,                // tag
+                             &PDF3d[recv],       // receive buffer (points to the starting address of the data chunk)
+                             1,                  // number of elements received
+                             stridex,            // type of elements
+                             nbr_EAST,           // source (where the data is coming from)
+                             444,                // tag
+                             CART_COMM,          // MPI Communicator used for this Sendrecv
+                             &status);           // MPI status
+            }
+            else
+            {
+                haloSendrecv(codec, PDF3d, send, recv, 1, MYP, MZP, MXP, MYP,
+                             nbr_WEST, 444, nbr_EAST, 444, CART_COMM);
+            }
         }
 
         // I am sending PDF3d data to the process nbr_NORTH and receiving PDF3d data from process nbr_SOUTH
@@ -277,21 +316,29 @@ void exchangePDF (const int      nn,                // number of ghost cell laye
             int ry = (nn - 1) - i;
             int rz = 0;
 
-            int send = sx + sy * MXP + sz * MXP*MYP; // send the bottommost (non-ghost) layer of data
-            int recv = rx + ry * MXP + rz * MXP*MYP; // receive data into the top ghost cell layer
-
-            MPI_Sendrecv(&PDF3d[send],       // send buffer (points to the starting address of the data chunk) 
-                         1,                  // number of elements to be sent
-                         stridey,            // type of elements
-                         nbr_NORTH,          // destination (where the data is going)
-                         555,                // tag
-                         &PDF3d[recv],       // receive buffer (points to the starting address of the data chunk)
-                         1,                  // number of elements received
-                         stridey,            // type of elements
-                         nbr_SOUTH,          // source (where the data is coming from)
-                         555,                // tag
-                         CART_COMM,          // MPI Communicator used for this Sendrecv
-                         &status);           // MPI status
+            long long send = sx + sy * MXP + (long long) sz * MXP*MYP; // send the bottommost (non-ghost) layer of data
+            long long recv = rx + ry * MXP + (long long) rz * MXP*MYP; // receive data into the top ghost cell layer
+
+            if(codec.mode == HALO_CODEC_NONE)
+            {
+                MPI_Sendrecv(&PDF3d[send],       // send buffer (points to the starting address of the data chunk) 
+                             1,                  // number of elements to be sent
+                             stridey,            // type of elements
+                             nbr_NORTH,          // destination (where the data is going)
+                             555,                // tag
+                             &PDF3d[recv],       // receive buffer (points to the starting address of the data chunk)
+                             1,                  // number of elements received
+                             stridey,            // type of elements
+                             nbr_SOUTH,          // source (where the data is coming from)
+                             555,                // tag
+                             CART_COMM,          // MPI Communicator used for this Sendrecv
+                             &status);           // MPI status
+            }
+            else
+            {
+                haloSendrecv(codec, PDF3d, send, recv, MXP, 1, MZP, MXP, MYP,
+                             nbr_NORTH, 555, nbr_SOUTH, 555, CART_COMM);
+            }
         }
 
         // I am sending PDF3d data to the process nbr_SOUTH and receiving PDF3d data from process nbr_NORTH
@@ -316,21 +363,29 @@ void exchangePDF (const int      nn,                // number of ghost cell laye
             int ry = nn + MY + i;
             int rz = 0;
 
-            int send = sx + sy * MXP + sz * MXP*MYP; // send the bottommost (non-ghost) layer of data
-            int recv = rx + ry * MXP + rz * MXP*MYP; // receive data into the top ghost cell layer
-
-            MPI_Sendrecv(&PDF3d[send],       // send buffer (points to the starting address of the data chunk) 
-                         1,                  // number of elements to be sent
-                         stridey,            // type of elements
-                         nbr_SOUTH,          // destination (where the data is going)
-                         666,                // tag
-                         &PDF3d[recv],       // receive buffer (points to the starting address of the data chunk)
-                         1,                  // number of elements received
-                         stridey,            // type of elements
-                         nbr_NORTH,          // source (where the data is coming from)
-                         666,                // tag
-                         CART_COMM,          // MPI Communicator used for this Sendrecv
-                         &status);           // MPI status
+            long long send = sx + sy * MXP + (long long) sz * MXP*MYP; // send the bottommost (non-ghost) layer of data
+            long long recv = rx + ry * MXP + (long long) rz * MXP*MYP; // receive data into the top ghost cell layer
+
+            if(codec.mode == HALO_CODEC_NONE)
+            {
+                MPI_Sendrecv(&PDF3d[send],       // send buffer (points to the starting address of the data chunk) 
+                             1,                  // number of elements to be sent
+                             stridey,            // type of elements
+                             nbr_SOUTH,          // destination (where the data is going)
+                             666,                // tag
+                             &PDF3d[recv],       // receive buffer (points to the starting address of the data chunk)
+                             1,                  // number of elements received
+                             stridey,            // type of elements
+                             nbr_NORTH,          // source (where the data is coming from)
+                             666,                // tag
+                             CART_COMM,          // MPI Communicator used for this Sendrecv
+                             &status);           // MPI status
+            }
+            else
+            {
+                haloSendrecv(codec, PDF3d, send, recv, MXP, 1, MZP, MXP, MYP,
+                             nbr_SOUTH, 666, nbr_NORTH, 666, CART_COMM);
+            }
         }
 
     } // end for loop over the number of ghost layers
@@ -342,10 +397,10 @@ void exchangePDF (const int      nn,                // number of ghost cell laye
                 for(int k = 0; k < MZP; k++) {
 
                     // natural index for fa(i,j,k) in PDF3d
-                    int index_3d = i + j*MXP + k*MXP*MYP;
+                    long long index_3d = i + j*MXP + (long long) k*MXP*MYP;
 
                     // natural index for f(i,j,k,a) in PDF4d
-                    int index_4d = a + (index_3d * Q);
+                    long long index_4d = a + (i + j*SX + k*SX*SY) * Q;
 
                     // PDF4d <---- PDF3d(a)
                     PDF4d[index_4d] = PDF3d[index_3d];
@@ -359,6 +414,5 @@ void exchangePDF (const int      nn,                // number of ghost cell laye
 
     } // end loop for PDF directions
 
-    // free memory for the temporary 3D array
-    delete [] PDF3d;
+    codec.time += MPI_Wtime() - t_beg;
 }
@@ -0,0 +1,273 @@
+#include "exchangeInfo.h"
+
+/**
+Partitioned exchange of particle distribution functions
+
+This follows the same sequence as exchangePDF (Z faces first, then X, then Y,
+so that edge ghost nodes are filled from the layers received earlier) but
+packs straight from the 4D array instead of copying every PDF direction into
+a temporary 3D array.
+
+Each face message is split into Q partitions, one per PDF direction. OpenMP
+threads pack the partitions in parallel and mark each one ready as soon as it
+is packed (MPI_Pready with MPI-4 partitioned communication, or MPI_Start on a
+per-partition persistent request with older MPI libraries), so data starts
+leaving the node before the whole face is packed.
+
+Messages are always sent in full precision; the halo codec only applies to
+exchangePDF.
+*/
+
+// copy partition "a" of one face between the 4D array and a message buffer
+
+static void copyFace(const halo_face & face, const int nn, const int Q, const int a,
+                     const long long SX, const long long SY,
+                     const int x0, const int y0, const int z0,
+                     double * PDF4d, double * buf, const bool pack)
+{
+    int n = a * face.partition;
+
+    for(int l = 0; l < nn; l++)
+    {
+        int lx = (face.normal == 0) ? face.layer_step * l : 0;
+        int ly = (face.normal == 1) ? face.layer_step * l : 0;
+        int lz = (face.normal == 2) ? face.layer_step * l : 0;
+
+        for(int k = 0; k < face.nz; k++) {
+            for(int j = 0; j < face.ny; j++) {
+                for(int i = 0; i < face.nx; i++) {
+
+                    // natural index for f(i,j,k,a) in PDF4d
+                    long long index_4d = a + Q * ((x0 + lx + i) + (y0 + ly + j)*SX + (z0 + lz + k)*SX*SY);
+
+                    if(pack) buf[n++] = PDF4d[index_4d];
+                    else     PDF4d[index_4d] = buf[n++];
+                }
+            }
+        }
+    }
+}
+
+// tell MPI that partition "a" of the face is packed
+
+static void markReady(halo_face & face, const int a)
+{
+#if MPI_VERSION >= 4
+    MPI_Pready(a, face.send_req);
+#else
+    MPI_Start(&face.send_reqs[a]);
+#endif
+}
+
+// describe one face of the exchange
+
+static void setFace(halo_face & face, const int normal, const int layer_step,
+                    const int dest, const int source, const int tag,
+                    const int sx, const int sy, const int sz,
+                    const int rx, const int ry, const int rz,
+                    const int nx, const int ny, const int nz)
+{
+    face.normal     = normal;
+    face.layer_step = layer_step;
+    face.dest       = dest;
+    face.source     = source;
+    face.tag        = tag;
+    face.send_x0    = sx;
+    face.send_y0    = sy;
+    face.send_z0    = sz;
+    face.recv_x0    = rx;
+    face.recv_y0    = ry;
+    face.recv_z0    = rz;
+    face.nx         = nx;
+    face.ny         = ny;
+    face.nz         = nz;
+}
+
+// allocate message buffers and create the persistent (partitioned) requests
+
+void haloPlanSetup(pdf_halo_plan  & plan,
+                   const int        nn,                // number of ghost cell layers
+                   const int        Q,                 // number of LBM streaming directions
+                   const int        MX,                // number of voxels along X in this process
+                   const int        MY,                // number of voxels along Y in this process
+                   const int        MZ,                // number of voxels along Z in this process
+                   const MPI_Comm   CART_COMM,         // Cartesian topology communicator
+                   const int        nbr_WEST,          // process id of my western neighbor
+                   const int        nbr_EAST,          // process id of my eastern neighbor
+                   const int        nbr_SOUTH,         // process id of my southern neighbor
+                   const int        nbr_NORTH,         // process id of my northern neighbor
+                   const int        nbr_BOTTOM,        // process id of my bottom neighbor
+                   const int        nbr_TOP,           // process id of my top neighbor
+                   const int        thread_provided)   // thread support level returned by MPI_Init_thread
+{
+    const int MXP = nn+MX+nn;  // padded voxels along X
+    const int MYP = nn+MY+nn;  // padded voxels along Y
+    const int MZP = nn+MZ+nn;  // padded voxels along Z
+
+    plan.nn           = nn;
+    plan.Q            = Q;
+    plan.MXP          = MXP;
+    plan.MYP          = MYP;
+    plan.MZP          = MZP;
+    plan.SX           = strideX(nn, MX);
+    plan.SY           = strideY(nn, MX, MY);
+    plan.thread_level = thread_provided;
+
+    // face, normal, layer step, destination, source, tag, send origin, receive origin, layer size
+    // (tags are Q apart: without MPI-4 each direction of a face is a message of its own, tag + a,
+    // and MPI only guarantees tags up to 32767)
+    setFace(plan.face[0], 2, -1, nbr_TOP,    nbr_BOTTOM, 1000 + 0*Q, 0, 0, nn + (MZ-1),      0, 0, nn - 1,      MXP, MYP, 1);
+    setFace(plan.face[1], 2, +1, nbr_BOTTOM, nbr_TOP,    1000 + 1*Q, 0, 0, nn,               0, 0, nn + MZ,     MXP, MYP, 1);
+    setFace(plan.face[2], 0, -1, nbr_EAST,   nbr_WEST,   1000 + 2*Q, nn + (MX-1), 0, 0,      nn - 1, 0, 0,      1, MYP, MZP);
+    setFace(plan.face[3], 0, +1, nbr_WEST,   nbr_EAST,   1000 + 3*Q, nn, 0, 0,               nn + MX, 0, 0,     1, MYP, MZP);
+    setFace(plan.face[4], 1, -1, nbr_NORTH,  nbr_SOUTH,  1000 + 4*Q, 0, nn + (MY-1), 0,      0, nn - 1, 0,      MXP, 1, MZP);
+    setFace(plan.face[5], 1, +1, nbr_SOUTH,  nbr_NORTH,  1000 + 5*Q, 0, nn, 0,               0, nn + MY, 0,     MXP, 1, MZP);
+
+    for(int f = 0; f < 6; f++)
+    {
+        halo_face & face = plan.face[f];
+
+        face.partition = nn * face.nx * face.ny * face.nz;
+        face.send_buf  = new double[Q * face.partition];
+        face.recv_buf  = new double[Q * face.partition];
+
+#if MPI_VERSION >= 4
+        MPI_Psend_init(face.send_buf, Q, face.partition, MPI_DOUBLE, face.dest,   face.tag, CART_COMM, MPI_INFO_NULL, &face.send_req);
+        MPI_Precv_init(face.recv_buf, Q, face.partition, MPI_DOUBLE, face.source, face.tag, CART_COMM, MPI_INFO_NULL, &face.recv_req);
+        face.send_reqs = NULL;
+        face.recv_reqs = NULL;
+#else
+        face.send_reqs = new MPI_Request[Q];
+        face.recv_reqs = new MPI_Request[Q];
+        for(int a = 0; a < Q; a++)
+        {
+            MPI_Send_init(&face.send_buf[a * face.partition], face.partition, MPI_DOUBLE,
+                          face.dest,   face.tag + a, CART_COMM, &face.send_reqs[a]);
+            MPI_Recv_init(&face.recv_buf[a * face.partition], face.partition, MPI_DOUBLE,
+                          face.source, face.tag + a, CART_COMM, &face.recv_reqs[a]);
+        }
+#endif
+    }
+}
+
+/**
+Partitioned MPI communication routine for exchanging (double-precision) values
+of particle distribution functions across the boundaries between MPI processes
+
+After calling this function, values in the ghost layers for {f0, f1, ..., f18}
+get updated using values from neighboring MPI processes
+*/
+void exchangePDFPartitioned(pdf_halo_plan & plan,
+                            double        * PDF4d,    // pointer to the 4D array being exchanged (of type double)
+                            halo_codec    & codec)    // only the exchange time is recorded here
+{
+    double t_beg = MPI_Wtime();
+
+    const int nn  = plan.nn;
+    const int Q   = plan.Q;
+    const long long SX = plan.SX;
+    const long long SY = plan.SY;
+
+    // faces are exchanged in pairs: Z first, then X (including the Z ghost layers), then Y
+
+    for(int pair = 0; pair < 3; pair++)
+    {
+        halo_face & face0 = plan.face[2*pair];
+        halo_face & face1 = plan.face[2*pair+1];
+
+        // post the receives and activate the sends (nothing is transferred until a partition is ready)
+
+#if MPI_VERSION >= 4
+        MPI_Start(&face0.recv_req);
+        MPI_Start(&face1.recv_req);
+        MPI_Start(&face0.send_req);
+        MPI_Start(&face1.send_req);
+#else
+        MPI_Startall(Q, face0.recv_reqs);
+        MPI_Startall(Q, face1.recv_reqs);
+#endif
+
+        // pack one PDF direction per iteration and release it immediately
+
+        #pragma omp parallel for schedule(dynamic)
+        for(int a = 0; a < Q; a++)
+        {
+            copyFace(face0, nn, Q, a, SX, SY, face0.send_x0, face0.send_y0, face0.send_z0, PDF4d, face0.send_buf, true);
+            copyFace(face1, nn, Q, a, SX, SY, face1.send_x0, face1.send_y0, face1.send_z0, PDF4d, face1.send_buf, true);
+
+            if(plan.thread_level >= MPI_THREAD_MULTIPLE)
+            {
+                markReady(face0, a);
+                markReady(face1, a);
+            }
+            else if(plan.thread_level >= MPI_THREAD_SERIALIZED)
+            {
+                #pragma omp critical(halo_ready)
+                {
+                    markReady(face0, a);
+                    markReady(face1, a);
+                }
+            }
+        }
+
+        // without thread support only the calling thread may talk to MPI
+
+        if(plan.thread_level < MPI_THREAD_SERIALIZED)
+        {
+            for(int a = 0; a < Q; a++)
+            {
+                markReady(face0, a);
+                markReady(face1, a);
+            }
+        }
+
+        // wait for the whole face pair
+
+#if MPI_VERSION >= 4
+        MPI_Request requests[4] = {face0.send_req, face1.send_req, face0.recv_req, face1.recv_req};
+        MPI_Waitall(4, requests, MPI_STATUSES_IGNORE);
+#else
+        MPI_Waitall(Q, face0.send_reqs, MPI_STATUSES_IGNORE);
+        MPI_Waitall(Q, face1.send_reqs, MPI_STATUSES_IGNORE);
+        MPI_Waitall(Q, face0.recv_reqs, MPI_STATUSES_IGNORE);
+        MPI_Waitall(Q, face1.recv_reqs, MPI_STATUSES_IGNORE);
+#endif
+
+        // unpack into the ghost layers
+
+        #pragma omp parallel for schedule(dynamic)
+        for(int a = 0; a < Q; a++)
+        {
+            copyFace(face0, nn, Q, a, SX, SY, face0.recv_x0, face0.recv_y0, face0.recv_z0, PDF4d, face0.recv_buf, false);
+            copyFace(face1, nn, Q, a, SX, SY, face1.recv_x0, face1.recv_y0, face1.recv_z0, PDF4d, face1.recv_buf, false);
+        }
+    }
+
+    codec.time += MPI_Wtime() - t_beg;
+}
+
+// release the persistent requests and message buffers
+
+void haloPlanFree(pdf_halo_plan & plan)
+{
+    for(int f = 0; f < 6; f++)
+    {
+        halo_face & face = plan.face[f];
+
+#if MPI_VERSION >= 4
+        MPI_Request_free(&face.send_req);
+        MPI_Request_free(&face.recv_req);
+#else
+        for(int a = 0; a < plan.Q; a++)
+        {
+            MPI_Request_free(&face.send_reqs[a]);
+            MPI_Request_free(&face.recv_reqs[a]);
+        }
+        delete [] face.send_reqs;
+        delete [] face.recv_reqs;
+#endif
+
+        delete [] face.send_buf;
+        delete [] face.recv_buf;
+    }
+}
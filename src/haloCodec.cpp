@@ -0,0 +1,345 @@
+#include "haloCodec.h"
+
+/**
+Reduced-precision encoding of PDF halo messages
+
+Each message carries one face of a single PDF direction. Values are sent as a
+deviation from the face average (which is close to the local equilibrium
+wt[a]*rho for that direction), so the few significant bits of a float16 or
+bfloat16 are spent on the part of f that actually varies.
+
+The sender decodes its own message and compares it against the exact values.
+If any value is off by more than codec.tol, the message is re-sent in full
+double precision instead. The receiver reads the header to find out which
+encoding was used.
+*/
+
+// header placed in front of every encoded halo message
+
+struct halo_header
+{
+    int    mode;    // encoding used for the payload
+    int    count;   // number of values in the payload
+    double shift;   // value subtracted from every entry before encoding
+    double scale;   // deviations are divided by this before encoding
+};
+
+// float <--> IEEE 754 binary16 (round to nearest even)
+
+static unsigned short float_to_half(float value)
+{
+    unsigned int x;
+    memcpy(&x, &value, sizeof(x));
+
+    unsigned int sign     = (x >> 16) & 0x8000;
+    int          exponent = (int) ((x >> 23) & 0xff) - 127 + 15;
+    unsigned int mantissa = x & 0x7fffff;
+
+    if(((x >> 23) & 0xff) == 0xff) return sign | 0x7c00 | (mantissa ? 0x200 : 0);  // inf or nan
+    if(exponent >= 31) return sign | 0x7c00;                                       // overflow
+
+    if(exponent <= 0)                                                              // subnormal
+    {
+        if(exponent < -10) return sign;
+        mantissa |= 0x800000;
+        int shift = 14 - exponent;
+        unsigned int half_m  = mantissa >> shift;
+        unsigned int rest    = mantissa & ((1u << shift) - 1);
+        unsigned int halfway = 1u << (shift - 1);
+        if(rest > halfway || (rest == halfway && (half_m & 1))) half_m++;
+        return sign | half_m;
+    }
+
+    unsigned int half = sign | (exponent << 10) | (mantissa >> 13);
+    unsigned int rest = mantissa & 0x1fff;
+    if(rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++;   // a carry correctly bumps the exponent
+    return half;
+}
+
+static float half_to_float(unsigned short h)
+{
+    unsigned int sign     = (h & 0x8000) << 16;
+    int          exponent = (h >> 10) & 0x1f;
+    unsigned int mantissa = h & 0x3ff;
+    unsigned int x;
+
+    if(exponent == 0)
+    {
+        if(mantissa == 0)
+        {
+            x = sign;
+        }
+        else
+        {
+            // normalise the subnormal value
+            exponent = 1;
+            while(!(mantissa & 0x400)) { mantissa <<= 1; exponent--; }
+            mantissa &= 0x3ff;
+            x = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+        }
+    }
+    else if(exponent == 31)
+    {
+        x = sign | 0x7f800000 | (mantissa << 13);
+    }
+    else
+    {
+        x = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+
+    float value;
+    memcpy(&value, &x, sizeof(value));
+    return value;
+}
+
+// float <--> bfloat16 (round to nearest even)
+
+static unsigned short float_to_bf16(float value)
+{
+    unsigned int x;
+    memcpy(&x, &value, sizeof(x));
+    x += 0x7fff + ((x >> 16) & 1);
+    return (unsigned short) (x >> 16);
+}
+
+static float bf16_to_float(unsigned short b)
+{
+    unsigned int x = ((unsigned int) b) << 16;
+    float value;
+    memcpy(&value, &x, sizeof(value));
+    return value;
+}
+
+// size in bytes of one encoded value
+
+static int codec_width(const int mode)
+{
+    if(mode == HALO_CODEC_FP32) return 4;
+    if(mode == HALO_CODEC_FP16) return 2;
+    if(mode == HALO_CODEC_BF16) return 2;
+    return 8;
+}
+
+// decode value number n from the payload
+
+static double codec_value(const halo_header & head, const char* payload, const int n)
+{
+    if(head.mode == HALO_CODEC_FP32)
+    {
+        float d;
+        memcpy(&d, payload + 4*n, 4);
+        return head.shift + head.scale * (double) d;
+    }
+    if(head.mode == HALO_CODEC_FP16 || head.mode == HALO_CODEC_BF16)
+    {
+        unsigned short d;
+        memcpy(&d, payload + 2*n, 2);
+        float dev = (head.mode == HALO_CODEC_FP16) ? half_to_float(d) : bf16_to_float(d);
+        return head.shift + head.scale * (double) dev;
+    }
+    double d;
+    memcpy(&d, payload + 8*n, 8);
+    return d;
+}
+
+// reset codec settings and statistics
+
+void haloCodecSetup(halo_codec & codec, const int mode, const double tol)
+{
+    codec.mode       = mode;
+    codec.tol        = tol;
+    codec.messages   = 0;
+    codec.fallbacks  = 0;
+    codec.bytes_raw  = 0.;
+    codec.bytes_sent = 0.;
+    codec.mass_error = 0.;
+    codec.time       = 0.;
+}
+
+/**
+Encode a box of nx*ny*nz values taken from a 3D array with row lengths MXP and
+MXP*MYP, starting at index "send", exchange it with MPI_Sendrecv, and decode
+the message received from "source" into the box starting at index "recv"
+*/
+void haloSendrecv(halo_codec & codec,
+                  double     * PDF3d,      // 3D array (one PDF direction, ghost layers included)
+                  const long long send,    // first index of the box to be sent
+                  const long long recv,    // first index of the box to be received
+                  const int    nx,         // box size along X
+                  const int    ny,         // box size along Y
+                  const int    nz,         // box size along Z
+                  const int    MXP,        // padded voxels along X
+                  const int    MYP,        // padded voxels along Y
+                  const int    dest,       // destination (where the data is going)
+                  const int    sendtag,    // tag for the outgoing message
+                  const int    source,     // source (where the data is coming from)
+                  const int    recvtag,    // tag for the incoming message
+                  const MPI_Comm CART_COMM)
+{
+    const int count    = nx*ny*nz;
+    const int max_size = sizeof(halo_header) + 8*count;
+
+    char *send_msg = (char*) workspace(WORKSPACE_HALO_SEND, max_size);
+    char *recv_msg = (char*) workspace(WORKSPACE_HALO_RECV, max_size);
+
+    // gather the values and their range
+
+    double *values = (double*) workspace(WORKSPACE_HALO_VALUES, count * sizeof(double));
+    double vmin =  1e300;
+    double vmax = -1e300;
+    int n = 0;
+    for(int k = 0; k < nz; k++) {
+        for(int j = 0; j < ny; j++) {
+            for(int i = 0; i < nx; i++) {
+                double value = PDF3d[send + i + j*MXP + (long long) k*MXP*MYP];
+                values[n++] = value;
+                if(value < vmin) vmin = value;
+                if(value > vmax) vmax = value;
+            }
+        }
+    }
+
+    // encode deviations from the face average
+
+    halo_header head;
+    head.mode  = codec.mode;
+    head.count = count;
+    head.shift = 0.5 * (vmin + vmax);
+    head.scale = (codec.mode == HALO_CODEC_FP32) ? 1.0 : 0.5 * (vmax - vmin);
+    if(head.scale == 0.) head.scale = 1.0;
+
+    char *payload = send_msg + sizeof(halo_header);
+    const double inv_scale = 1.0 / head.scale;
+    for(n = 0; n < count; n++)
+    {
+        float dev = (float) ((values[n] - head.shift) * inv_scale);
+        if(head.mode == HALO_CODEC_FP32)
+        {
+            memcpy(payload + 4*n, &dev, 4);
+        }
+        else
+        {
+            unsigned short d = (head.mode == HALO_CODEC_FP16) ? float_to_half(dev) : float_to_bf16(dev);
+            memcpy(payload + 2*n, &d, 2);
+        }
+    }
+
+    // check the error bound, fall back to full precision if it is exceeded
+
+    double max_error = 0.;
+    double sum_error = 0.;
+    for(n = 0; n < count; n++)
+    {
+        double error = codec_value(head, payload, n) - values[n];
+        sum_error += error;
+        if(fabs(error) > max_error) max_error = fabs(error);
+    }
+
+    if(max_error > codec.tol)
+    {
+        head.mode  = HALO_CODEC_NONE;
+        head.shift = 0.;
+        head.scale = 1.;
+        memcpy(payload, values, 8*count);
+        sum_error = 0.;
+        codec.fallbacks++;
+    }
+    memcpy(send_msg, &head, sizeof(halo_header));
+
+    const int msg_size = sizeof(halo_header) + codec_width(head.mode)*count;
+
+    codec.messages++;
+    codec.bytes_raw  += 8.0*count;
+    codec.bytes_sent += msg_size;
+    codec.mass_error += sum_error;
+
+    MPI_Status status;
+    MPI_Sendrecv(send_msg,           // send buffer (encoded message)
+                 msg_size,           // number of bytes to be sent
+                 MPI_BYTE,           // type of elements
+                 dest,               // destination (where the data is going)
+                 sendtag,            // tag
+                 recv_msg,           // receive buffer (large enough for a full precision message)
+                 max_size,           // maximum number of bytes received
+                 MPI_BYTE,           // type of elements
+                 source,             // source (where the data is coming from)
+                 recvtag,            // tag
+                 CART_COMM,          // MPI Communicator used for this Sendrecv
+                 &status);           // MPI status
+
+    // decode the message into the ghost layer
+
+    memcpy(&head, recv_msg, sizeof(halo_header));
+    payload = recv_msg + sizeof(halo_header);
+    n = 0;
+    for(int k = 0; k < nz; k++) {
+        for(int j = 0; j < ny; j++) {
+            for(int i = 0; i < nx; i++) {
+                PDF3d[recv + i + j*MXP + (long long) k*MXP*MYP] = codec_value(head, payload, n++);
+            }
+        }
+    }
+}
+
+// total mass (sum of rho over interior nodes) across all MPI ranks
+
+double totalMass(const int nn, const int LX, const int LY, const int LZ,
+                 const double* rho, const MPI_Comm CART_COMM)
+{
+    const long long GX = strideX(nn, LX);
+    const long long GY = strideY(nn, LX, LY);
+
+    double local_mass = 0.;
+    for(int k = 0; k < LZ; k++)
+    {
+        int K = nn+k;
+        for(int j = 0; j < LY; j++)
+        {
+            int J = nn+j;
+            for(int i = 0; i < LX; i++)
+            {
+                int I = nn+i;
+                local_mass += rho[I + GX*J + GX*GY*K];
+            }
+        }
+    }
+
+    double global_mass = 0.;
+    MPI_Allreduce(&local_mass, &global_mass, 1, MPI_DOUBLE, MPI_SUM, CART_COMM);
+    return global_mass;
+}
+
+// print compression, timing and mass conservation statistics for the PDF halo exchanges
+
+void haloCodecReport(const halo_codec & codec,
+                     const double       mass_initial,
+                     const double       mass_final,
+                     const int          myid,
+                     const MPI_Comm     CART_COMM)
+{
+    double local_stats[4]  = {codec.bytes_raw, codec.bytes_sent, codec.mass_error, (double) codec.fallbacks};
+    double global_stats[4];
+    MPI_Reduce(local_stats, global_stats, 4, MPI_DOUBLE, MPI_SUM, 0, CART_COMM);
+
+    double max_time = 0.;
+    MPI_Reduce(&codec.time, &max_time, 1, MPI_DOUBLE, MPI_MAX, 0, CART_COMM);
+
+    long long messages = 0;
+    MPI_Reduce(&codec.messages, &messages, 1, MPI_LONG_LONG, MPI_SUM, 0, CART_COMM);
+
+    if(myid == 0)
+    {
+        const char* names[] = {"none", "fp32", "fp16", "bf16"};
+        std::cout << std::endl;
+        std::cout << "PDF halo codec          : " << names[codec.mode] << " (tol = " << codec.tol << ")" << std::endl;
+        std::cout << "time in exchangePDF     : " << max_time << " s (slowest rank)" << std::endl;
+        if(codec.mode != HALO_CODEC_NONE)
+        {
+            std::cout << "halo messages           : " << messages << " (" << (long long) global_stats[3] << " sent in full precision)" << std::endl;
+            std::cout << "halo compression ratio  : " << global_stats[0] / global_stats[1] << std::endl;
+            std::cout << "summed encoding error   : " << global_stats[2] << std::endl;
+        }
+        std::cout << "total mass drift        : " << mass_final - mass_initial
+                  << " (relative " << (mass_final - mass_initial) / mass_initial << ")" << std::endl;
+    }
+}
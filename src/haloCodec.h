@@ -0,0 +1,35 @@
+#ifndef HALO_CODEC_H
+#define HALO_CODEC_H
+
+#include <iostream>
+#include <cstring>    // memcpy
+#include <cmath>      // fabs
+#include <mpi.h>      // MPI header files
+
+#include "latticeArena.h"  // workspace, strideX, strideY
+
+// encodings available for PDF halo messages
+
+enum
+{
+    HALO_CODEC_NONE = 0,   // full double precision (no compression)
+    HALO_CODEC_FP32 = 1,   // shifted deviation stored as float32
+    HALO_CODEC_FP16 = 2,   // shifted and scaled deviation stored as IEEE float16
+    HALO_CODEC_BF16 = 3    // shifted and scaled deviation stored as bfloat16
+};
+
+// codec settings and running statistics for one family of halo exchanges
+
+struct halo_codec
+{
+    int       mode;          // one of HALO_CODEC_*
+    double    tol;           // maximum absolute error allowed per PDF value
+    long long messages;      // number of halo messages sent
+    long long fallbacks;     // messages sent in full precision because tol was exceeded
+    double    bytes_raw;     // bytes the messages would have needed in double precision
+    double    bytes_sent;    // bytes actually sent (including headers)
+    double    mass_error;    // sum of (decoded - exact) over all values sent
+    double    time;          // wall clock time spent inside exchangePDF
+};
+
+#endif
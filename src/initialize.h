@@ -5,4 +5,14 @@
       #include <cmath>        // using math functions 
 //    #include <ctime>        // clock_t, clock(), CLOCKS_PER_SEC
 
+      #include "latticeArena.h" // strideX, strideY
+
+//    initial density field
+
+      enum
+      {
+        INIT_CYLINDER = 0,   // liquid cylinder along X with a wavy radius (Rayleigh-Plateau)
+        INIT_SPINODAL = 1    // uniform density with 1% random noise (spinodal decomposition)
+      };
+
 #endif
@@ -0,0 +1,327 @@
+#include "ioServer.h"
+
+#include "outputCodec.h"   // output_codec, outputCodecCreate (includes hdf5.h)
+
+/**
+Dedicated I/O server ranks
+
+On large jobs it pays to give up a few ranks so that the others never touch
+the file system. With io_server_ratio = R, the last rank of every group of R
+consecutive world ranks becomes an I/O server for the other ranks of its
+group (the remainder of the world ranks joins the last group). The compute
+ranks form CART_COMM as before, so the number of compute ranks has to match
+dims[0] x dims[1] x dims[2].
+
+At a frame step a compute rank packs the interior of rho and sends it to its
+server with non-blocking sends; it only waits for the previous frame to be
+delivered before packing the next one. The server receives the frame of
+every client and writes them as the datasets of one HDF5 file (plus one XDMF
+file), so the number of files per frame drops by a factor of R-1, and each
+file is written in large contiguous pieces. Once both files of a frame are
+closed, the server acknowledges the frame to each of its clients, so the
+compute ranks know which frames are complete (the XDMF time series only
+lists those). Compute ranks tell their server when they are done with a
+header carrying time = -1, after which they collect the outstanding
+acknowledgments.
+*/
+
+// split MPI_COMM_WORLD into compute ranks (returned in COMPUTE_COMM) and I/O servers
+
+void ioServerSplit(io_server & io,
+                   const int   ratio,          // world ranks per server (0: no I/O servers)
+                   MPI_Comm &  COMPUTE_COMM)   // ranks running the solver
+{
+    io.enabled       = ratio > 1;
+    io.server        = false;
+    io.in_flight     = false;
+    io.sent          = 0;
+    io.acked         = 0;
+    io.ack_posted    = false;
+    io.written       = -1;
+    io.send_time     = 0.;
+    io.bytes_sent    = 0;
+    io.frames        = 0;
+    io.write_time    = 0.;
+    io.recv_time     = 0.;
+    io.bytes_written = 0;
+    io.IO_COMM       = MPI_COMM_NULL;
+    COMPUTE_COMM     = MPI_COMM_WORLD;
+
+    if(!io.enabled) return;
+
+    int world_size, world_rank;
+    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+    MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+    MPI_Comm_dup(MPI_COMM_WORLD, &io.IO_WORLD);
+
+    // group g = ranks [g*ratio, (g+1)*ratio), its last rank serves the others
+
+    const int servers = std::max(1, world_size / ratio);
+    auto group  = [&](const int r) { return std::min(r / ratio, servers - 1); };
+    auto server = [&](const int g) { return (g == servers - 1) ? world_size - 1 : g*ratio + ratio - 1; };
+
+    io.server_id   = group(world_rank);
+    io.server_rank = server(io.server_id);
+    io.server      = (world_rank == io.server_rank);
+
+    if(io.server)
+    {
+        for(int r = 0; r < world_size; r++)
+        {
+            if(group(r) == io.server_id && r != world_rank) io.clients.push_back(r);
+        }
+    }
+
+    MPI_Comm_split(MPI_COMM_WORLD, io.server ? 1 : 0, world_rank, io.server ? &io.IO_COMM : &COMPUTE_COMM);
+}
+
+// client: send the interior of "field" (ghosted and padded like rho) as the frame of time "time"
+
+void ioClientSend(io_server & io,
+                  const int   time,
+                  const double* field,
+                  const long long SX,          // row stride of field
+                  const long long SY,          // rows per plane of field
+                  const int   nn,
+                  const int   offset_x, const int offset_y, const int offset_z,
+                  const int   LX, const int LY, const int LZ)
+{
+    double t_beg = MPI_Wtime();
+
+    // the previous frame must be delivered before its buffer is reused
+
+    if(io.in_flight) MPI_Waitall(2, io.requests, MPI_STATUSES_IGNORE);
+
+    io.header.time     = time;
+    io.header.offset_x = offset_x;
+    io.header.offset_y = offset_y;
+    io.header.offset_z = offset_z;
+    io.header.LX       = LX;
+    io.header.LY       = LY;
+    io.header.LZ       = LZ;
+
+    io.send_buffer.resize((long long) LX*LY*LZ);
+    long long n = 0;
+    for(int k = 0; k < LZ; k++) {
+        for(int j = 0; j < LY; j++) {
+            const double *row = field + (nn + SX*(nn + j) + SX*SY*(nn + k));
+            for(int i = 0; i < LX; i++) io.send_buffer[n++] = row[i];
+        }
+    }
+
+    MPI_Isend(&io.header, sizeof(io_frame_header), MPI_BYTE, io.server_rank, IO_TAG_HEADER, io.IO_WORLD, &io.requests[0]);
+    MPI_Isend(io.send_buffer.data(), (int) n, MPI_DOUBLE, io.server_rank, IO_TAG_DATA, io.IO_WORLD, &io.requests[1]);
+    io.in_flight   = true;
+    io.sent++;
+    io.bytes_sent += n * sizeof(double);
+
+    io.send_time += MPI_Wtime() - t_beg;
+}
+
+// client: collect the acknowledgments that have arrived (all outstanding ones with "wait");
+// returns the lattice time of the last frame the server has written (-1: none yet)
+
+static int ioClientAcks(io_server & io, const bool wait)
+{
+    while(io.acked < io.sent)
+    {
+        if(!io.ack_posted)
+        {
+            MPI_Irecv(&io.ack_time, 1, MPI_INT, io.server_rank, IO_TAG_DONE, io.IO_WORLD, &io.ack_request);
+            io.ack_posted = true;
+        }
+
+        int arrived = 1;
+        if(wait) MPI_Wait(&io.ack_request, MPI_STATUS_IGNORE);
+        else     MPI_Test(&io.ack_request, &arrived, MPI_STATUS_IGNORE);
+        if(!arrived) break;
+
+        io.ack_posted = false;
+        io.acked++;
+        io.written = io.ack_time;
+    }
+    return io.written;
+}
+
+int ioClientWritten(io_server & io)
+{
+    return ioClientAcks(io, false);
+}
+
+// client: wait for the last frame and tell the server that no more frames will come
+
+void ioClientFinish(io_server & io)
+{
+    if(!io.enabled || io.server) return;
+
+    double t_beg = MPI_Wtime();
+    if(io.in_flight) MPI_Waitall(2, io.requests, MPI_STATUSES_IGNORE);
+    io.in_flight = false;
+
+    io_frame_header stop = {-1, 0, 0, 0, 0, 0, 0};
+    MPI_Send(&stop, sizeof(io_frame_header), MPI_BYTE, io.server_rank, IO_TAG_HEADER, io.IO_WORLD);
+    ioClientAcks(io, true);
+    io.send_time += MPI_Wtime() - t_beg;
+}
+
+// server: write the blocks of all clients for one frame into one HDF5 file and one XDMF file
+
+static void ioServerWrite(io_server & io, const double delta, output_codec & codec,
+                          const std::vector<io_frame_header> & headers,
+                          std::vector<std::vector<double> > & blocks)
+{
+    const int time = headers[0].time;
+
+    std::stringstream file_name;
+    file_name << "t_" << std::setw(6) << std::setfill('0') << time << "_io_" << std::setw(3) << std::setfill('0') << io.server_id;
+
+    std::string hdf5_file_with_path = "../out/hdf5/data_" + file_name.str() + ".h5";
+    std::string hdf5_file = "data_" + file_name.str() + ".h5";
+    hid_t file_id = H5Fcreate(hdf5_file_with_path.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+
+    std::ofstream XDMF;
+    std::string xdmf_filename = "../out/xdmf/data_" + file_name.str() + ".xmf";
+    XDMF.open(xdmf_filename.c_str());
+    if(XDMF.fail())
+    {
+        std::cout << "ERROR: could not open file for writing XDMF output!" << std::endl;
+    }
+
+    for(size_t c = 0; c < headers.size(); c++)
+    {
+        const io_frame_header & h = headers[c];
+
+        // one dataset per client, named after its world rank
+
+        std::stringstream dataset_name;
+        dataset_name << "rho_mpi_" << std::setw(3) << std::setfill('0') << io.clients[c];
+
+        if(codec.benchmark) outputCodecBenchmark(codec, blocks[c].data(), h.LX, h.LY, h.LZ, io.server_rank);
+        outputCodecQuantize(codec, blocks[c].data(), blocks[c].size());
+
+        double  t_beg    = MPI_Wtime();
+        hsize_t dimsf[3] = {(hsize_t) h.LZ, (hsize_t) h.LY, (hsize_t) h.LX};
+        hid_t   dataset  = outputCodecCreate(codec, file_id, dataset_name.str().c_str(), dimsf);
+        H5Dwrite(dataset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, blocks[c].data());
+        outputCodecRecord(codec, dataset, (double) blocks[c].size() * sizeof(double), MPI_Wtime() - t_beg);
+
+        // position of the block in the global lattice (Z, Y, X as the dataset)
+
+        int     offset[3] = {h.offset_z, h.offset_y, h.offset_x};
+        hsize_t dimsa[1]  = {3};
+        hid_t   attrspace = H5Screate_simple(1, dimsa, NULL);
+        hid_t   attribute = H5Acreate2(dataset, "global_offset", H5T_STD_I32LE, attrspace, H5P_DEFAULT, H5P_DEFAULT);
+        H5Awrite(attribute, H5T_NATIVE_INT, offset);
+
+        H5Aclose(attribute);
+        H5Sclose(attrspace);
+        H5Dclose(dataset);
+
+        io.bytes_written += blocks[c].size() * sizeof(double);
+
+        XDMF << "    <Grid Name=\"mesh " << dataset_name.str().substr(4) << "\" GridType=\"Uniform\">\n";
+        XDMF << "        <Topology TopologyType=\"3DCoRectMesh\" Dimensions=\"" << h.LZ << " " << h.LY << " " << h.LX << "\" >\n";
+        XDMF << "        </Topology>\n";
+        XDMF << "        <Geometry GeometryType=\"ORIGIN_DXDYDZ\">\n";
+        XDMF << "            <DataItem Format=\"XML\" NumberType=\"Float\" Dimensions=\"3\">\n";
+        XDMF << "                " << h.offset_z*delta << " " << h.offset_y*delta << " " << h.offset_x*delta << "\n";
+        XDMF << "            </DataItem>\n";
+        XDMF << "            <DataItem Format=\"XML\" NumberType=\"Float\" Dimensions=\"3\">\n";
+        XDMF << "                " << delta << " " << delta << " " << delta << "\n";
+        XDMF << "            </DataItem>\n";
+        XDMF << "        </Geometry>\n";
+        XDMF << "        <Attribute Name=\"rho\" AttributeType=\"Scalar\" Center=\"Node\">\n";
+        XDMF << "            <DataItem Dimensions=\"" << h.LZ << " " << h.LY << " " << h.LX << "\" Precision=\" 8 \" Format=\"HDF\">\n";
+        XDMF << "                " << "./hdf5/" << hdf5_file << ":/" << dataset_name.str() << "\n";
+        XDMF << "            </DataItem>\n";
+        XDMF << "        </Attribute>\n";
+        XDMF << "    </Grid>\n";
+    }
+
+    H5Fclose(file_id);
+    XDMF.close();
+}
+
+// server: receive and write frames until every client has finished
+
+void ioServerRun(io_server & io, const double delta, output_codec & codec)
+{
+    const int num_clients = io.clients.size();
+    std::vector<io_frame_header>        headers(num_clients);
+    std::vector<std::vector<double> >   blocks(num_clients);
+
+    int active = num_clients;
+    while(active > 0)
+    {
+        // clients send their frames in time order, so the next message of every client belongs to the same frame
+
+        double t_beg = MPI_Wtime();
+        active = 0;
+        for(int c = 0; c < num_clients; c++)
+        {
+            MPI_Recv(&headers[c], sizeof(io_frame_header), MPI_BYTE, io.clients[c], IO_TAG_HEADER, io.IO_WORLD, MPI_STATUS_IGNORE);
+            if(headers[c].time < 0) continue;
+            active++;
+
+            blocks[c].resize((long long) headers[c].LX * headers[c].LY * headers[c].LZ);
+            MPI_Recv(blocks[c].data(), (int) blocks[c].size(), MPI_DOUBLE, io.clients[c], IO_TAG_DATA, io.IO_WORLD, MPI_STATUS_IGNORE);
+        }
+        io.recv_time += MPI_Wtime() - t_beg;
+
+        if(active == 0) break;
+        if(active != num_clients)
+        {
+            std::cout << "ERROR: I/O server " << io.server_id << " got a partial frame, clients out of step" << std::endl;
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+
+        t_beg = MPI_Wtime();
+        ioServerWrite(io, delta, codec, headers, blocks);
+        io.write_time += MPI_Wtime() - t_beg;
+        io.frames++;
+
+        // the files of this frame are closed: tell the clients
+        for(int c = 0; c < num_clients; c++)
+        {
+            MPI_Send(&headers[c].time, 1, MPI_INT, io.clients[c], IO_TAG_DONE, io.IO_WORLD);
+        }
+    }
+}
+
+// print the time the solver spent on output and the throughput of the servers
+
+void ioServerReport(const io_server & io, const int myid, const MPI_Comm CART_COMM)
+{
+    if(!io.enabled) return;
+
+    if(io.server)
+    {
+        double    local_times[2] = {io.write_time, io.recv_time};
+        double    max_times[2];
+        long long bytes = 0;
+        int       servers, server_id;
+        MPI_Reduce(local_times, max_times, 2, MPI_DOUBLE, MPI_MAX, 0, io.IO_COMM);
+        MPI_Reduce(&io.bytes_written, &bytes, 1, MPI_LONG_LONG, MPI_SUM, 0, io.IO_COMM);
+        MPI_Comm_size(io.IO_COMM, &servers);
+        MPI_Comm_rank(io.IO_COMM, &server_id);
+
+        if(server_id == 0)
+        {
+            std::cout << std::endl;
+            std::cout << "I/O servers             : " << servers << " (" << io.clients.size() << " clients on server 0, "
+                      << io.frames << " frames)" << std::endl;
+            std::cout << "server write time       : " << max_times[0] << " s (slowest server), "
+                      << (max_times[0] > 0. ? bytes / max_times[0] / 1.0e6 / servers : 0.) << " MB/s per server" << std::endl;
+            std::cout << "server receive time     : " << max_times[1] << " s (includes waiting for the solver)" << std::endl;
+        }
+        return;
+    }
+
+    double send_time;
+    MPI_Reduce(&io.send_time, &send_time, 1, MPI_DOUBLE, MPI_MAX, 0, CART_COMM);
+    if(myid == 0)
+    {
+        std::cout << std::endl;
+        std::cout << "output shipped to I/O servers, solver time spent on output: " << send_time << " s (slowest rank)" << std::endl;
+    }
+}
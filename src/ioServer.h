@@ -0,0 +1,63 @@
+#ifndef IO_SERVER_H
+#define IO_SERVER_H
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>  // std::min, std::max
+#include <mpi.h>      // MPI header files
+
+// dedicated I/O server ranks
+//
+// MPI_COMM_WORLD is split into compute ranks (which form CART_COMM) and I/O server ranks;
+// every compute rank ships its snapshot frames to one server, which writes the frames
+// of all its clients into one HDF5 file per frame
+
+enum
+{
+    IO_TAG_HEADER = 7001,   // frame header: time, global offset and size of the block
+    IO_TAG_DATA   = 7002,   // interior rho of the block
+    IO_TAG_DONE   = 7003    // server to client: the frame of this time is written
+};
+
+struct io_frame_header
+{
+    int time;                        // lattice time (-1: client has finished)
+    int offset_x, offset_y, offset_z;// global index of the first node of the block
+    int LX, LY, LZ;                  // nodes of the block
+};
+
+struct io_server
+{
+    bool              enabled;      // ranks are split into compute and I/O groups
+    bool              server;       // this rank is an I/O server
+    MPI_Comm          IO_WORLD;     // all ranks, for client-server messages
+    MPI_Comm          IO_COMM;      // the I/O servers (servers only)
+    int               server_rank;  // my server in IO_WORLD (clients only)
+    int               server_id;    // index of my server among the servers
+    std::vector<int>  clients;      // compute ranks (IO_WORLD) served by this rank (servers only)
+
+    // client side
+    std::vector<double> send_buffer;   // packed interior of the frame in flight
+    io_frame_header     header;        // header of the frame in flight
+    MPI_Request         requests[2];   // header and data sends of the frame in flight
+    bool                in_flight;     // requests above are still active
+    int                 sent;          // frames sent
+    int                 acked;         // frames the server has reported written
+    int                 ack_time;      // receive buffer of the next acknowledgment
+    MPI_Request         ack_request;   // receive of the next acknowledgment
+    bool                ack_posted;    // ack_request is active
+    int                 written;       // lattice time of the last frame written by the server (-1: none)
+    double              send_time;     // time the solver spent packing and waiting for sends
+    long long           bytes_sent;
+
+    // server side
+    int                 frames;        // frames written
+    double              write_time;    // time spent in HDF5
+    double              recv_time;     // time spent receiving frames
+    long long           bytes_written;
+};
+
+#endif
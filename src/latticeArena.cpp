@@ -0,0 +1,326 @@
+#include "latticeArena.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>      // mmap, madvise, munmap
+#include <unistd.h>        // sysconf, syscall
+#endif
+#ifdef __linux__
+#include <sys/syscall.h>   // SYS_mbind
+#endif
+
+/**
+Memory for the lattice fields
+
+All fields of this process (rho, u, v, w, dPdt, f, f_eq, f_new) are carved
+out of one slab. Every field starts on a 64-byte boundary. The slab is
+mapped once and can be backed by transparent or explicit huge pages, which
+cuts TLB misses in the streaming step, whose reads jump across Z planes. It
+can optionally be bound to one NUMA node. The binding is set before the
+fields are first touched in initialize().
+
+Row and plane strides can be padded so that the nodes a stencil touches in
+neighboring rows and planes do not land in the same cache sets (see
+strideSetup). Every field is then laid out as strideX * strideY * (nn+NZ+nn)
+nodes; the padding nodes are never read by the kernels and are not exchanged
+or written to file.
+
+Scratch buffers used inside the time loop (halo messages, psi planes, output
+coordinates) come from a small pool of slots. A slot grows the first time it
+is used and is reused from then on, so the time loop does no further heap
+allocation.
+*/
+
+static const size_t ARENA_ALIGN = 64;                 // cache line
+static const size_t HUGE_PAGE   = 2 * 1024 * 1024;    // x86-64 huge page
+
+static size_t roundUp(const size_t n, const size_t m)
+{
+    return (n + m - 1) / m * m;
+}
+
+// map "bytes" with the requested page backing, *pages returns what was actually obtained
+
+static void* mapMemory(size_t & bytes, const int request, int * pages, bool * mapped)
+{
+    void *ptr = NULL;
+    *pages  = ARENA_PAGES_DEFAULT;
+    *mapped = false;
+
+#if defined(MAP_ANONYMOUS)
+    if(request != ARENA_PAGES_DEFAULT) bytes = roundUp(bytes, HUGE_PAGE);
+
+#ifdef MAP_HUGETLB
+    if(request == ARENA_PAGES_EXPLICIT)
+    {
+        ptr = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if(ptr != MAP_FAILED)
+        {
+            *pages  = ARENA_PAGES_EXPLICIT;
+            *mapped = true;
+            return ptr;
+        }
+    }
+#endif
+
+    ptr = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(ptr != MAP_FAILED)
+    {
+        *mapped = true;
+#ifdef MADV_HUGEPAGE
+        if(request != ARENA_PAGES_DEFAULT && madvise(ptr, bytes, MADV_HUGEPAGE) == 0) *pages = ARENA_PAGES_TRANSPARENT;
+#endif
+        return ptr;
+    }
+#endif
+
+    if(posix_memalign(&ptr, ARENA_ALIGN, bytes) != 0) return NULL;
+    return ptr;
+}
+
+static void unmapMemory(void * ptr, const size_t bytes, const bool mapped)
+{
+#if defined(MAP_ANONYMOUS)
+    if(mapped)
+    {
+        munmap(ptr, bytes);
+        return;
+    }
+#endif
+    free(ptr);
+}
+
+// map the slab for "bytes" of fields
+
+void arenaCreate(lattice_arena & arena,
+                 const size_t    bytes,       // total size of all fields (including alignment padding)
+                 const int       pages,       // ARENA_PAGES_*
+                 const int       numa_node)   // bind the slab to this NUMA node (-1: no binding)
+{
+    arena.capacity  = roundUp(bytes, ARENA_ALIGN);
+    arena.used      = 0;
+    arena.numa_node = -1;
+    arena.base      = (char*) mapMemory(arena.capacity, pages, &arena.pages, &arena.mapped);
+
+    if(arena.base == NULL)
+    {
+        std::cout << "ERROR: could not allocate " << arena.capacity << " bytes for the lattice fields" << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+#if defined(__linux__) && defined(SYS_mbind)
+    if(numa_node >= 0 && arena.mapped)
+    {
+        const int MPOL_BIND_MODE = 2;   // MPOL_BIND from <numaif.h>
+        unsigned long mask = 1UL << numa_node;
+        if(syscall(SYS_mbind, arena.base, arena.capacity, MPOL_BIND_MODE, &mask, 8*sizeof(mask), 0) == 0)
+        {
+            arena.numa_node = numa_node;
+        }
+    }
+#endif
+}
+
+// hand out the next "count" doubles (64-byte aligned, zero-filled when mapped)
+
+double* arenaAlloc(lattice_arena & arena, const long long count)
+{
+    size_t bytes = roundUp(count * sizeof(double), ARENA_ALIGN);
+    if(arena.used + bytes > arena.capacity)
+    {
+        std::cout << "ERROR: lattice arena exhausted" << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    double *field = (double*) (arena.base + arena.used);
+    arena.used += bytes;
+    return field;
+}
+
+// give the pages of a field that is no longer needed back to the operating system
+
+void arenaDiscard(lattice_arena & arena, double * field, const long long count)
+{
+#if defined(MADV_DONTNEED)
+    if(!arena.mapped || field == NULL) return;
+
+    const size_t page = (arena.pages == ARENA_PAGES_DEFAULT) ? (size_t) sysconf(_SC_PAGESIZE) : HUGE_PAGE;
+    size_t beg = roundUp((size_t) ((char*) field - arena.base), page);
+    size_t end = ((size_t) ((char*) field - arena.base) + count * sizeof(double)) / page * page;
+    if(end > beg) madvise(arena.base + beg, end - beg, MADV_DONTNEED);
+#endif
+}
+
+// unmap the slab
+
+void arenaRelease(lattice_arena & arena)
+{
+    if(arena.base) unmapMemory(arena.base, arena.capacity, arena.mapped);
+    arena.base     = NULL;
+    arena.capacity = 0;
+    arena.used     = 0;
+}
+
+// workspace pool
+
+struct workspace_slot
+{
+    void   *ptr;
+    size_t  bytes;
+    bool    mapped;
+};
+
+static workspace_slot workspace_slots[WORKSPACE_SLOTS];
+static std::mutex     workspace_mutex;                 // slots may be grown from the communication thread
+static int            workspace_pages       = ARENA_PAGES_DEFAULT;
+static long long      workspace_allocations = 0;       // times a slot had to be (re)allocated
+
+void workspaceSetup(const int pages)
+{
+    workspace_pages = pages;
+}
+
+// scratch buffer of at least "bytes" for one slot; the contents are not preserved when it grows
+
+void* workspace(const int slot, const size_t bytes)
+{
+    workspace_slot & ws = workspace_slots[slot];
+    if(ws.bytes >= bytes) return ws.ptr;
+
+    std::lock_guard<std::mutex> lock(workspace_mutex);
+    if(ws.ptr) unmapMemory(ws.ptr, ws.bytes, ws.mapped);
+
+    // small buffers do not benefit from huge pages
+    int pages;
+    ws.bytes = roundUp(bytes, ARENA_ALIGN);
+    ws.ptr   = mapMemory(ws.bytes, (bytes >= HUGE_PAGE) ? workspace_pages : ARENA_PAGES_DEFAULT, &pages, &ws.mapped);
+    workspace_allocations++;
+
+    if(ws.ptr == NULL)
+    {
+        std::cout << "ERROR: could not allocate " << bytes << " bytes of workspace" << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    return ws.ptr;
+}
+
+long long workspaceAllocations()
+{
+    std::lock_guard<std::mutex> lock(workspace_mutex);
+    return workspace_allocations;
+}
+
+void workspaceRelease()
+{
+    for(int slot = 0; slot < WORKSPACE_SLOTS; slot++)
+    {
+        workspace_slot & ws = workspace_slots[slot];
+        if(ws.ptr) unmapMemory(ws.ptr, ws.bytes, ws.mapped);
+        ws.ptr   = NULL;
+        ws.bytes = 0;
+    }
+}
+
+// stride padding
+
+static bool      stride_padding = false;
+static long long cache_line     = 64;                // bytes
+static long long cache_way[2]   = {4096, 65536};     // bytes covered by one way (size / associativity) of L1 and L2
+static long long node_bytes[2]  = {8, 19*8};         // one scalar field value, all PDFs of a node
+
+#if defined(_SC_LEVEL1_DCACHE_LINESIZE) && defined(_SC_LEVEL2_CACHE_ASSOC)
+static long long cacheValue(const int name, const long long fallback)
+{
+    long long value = sysconf(name);
+    return (value > 0) ? value : fallback;
+}
+#endif
+
+// read the cache geometry on rank 0 (all ranks must agree on the strides, the halo messages depend on them)
+
+void strideSetup(const bool pad, const int Q, const MPI_Comm CART_COMM)
+{
+    long long geometry[3] = {cache_line, cache_way[0], cache_way[1]};
+
+    int myid;
+    MPI_Comm_rank(CART_COMM, &myid);
+    if(myid == 0)
+    {
+#if defined(_SC_LEVEL1_DCACHE_LINESIZE) && defined(_SC_LEVEL2_CACHE_ASSOC)
+        geometry[0] = cacheValue(_SC_LEVEL1_DCACHE_LINESIZE, cache_line);
+        geometry[1] = cacheValue(_SC_LEVEL1_DCACHE_SIZE, 32768)   / cacheValue(_SC_LEVEL1_DCACHE_ASSOC, 8);
+        geometry[2] = cacheValue(_SC_LEVEL2_CACHE_SIZE,  1048576) / cacheValue(_SC_LEVEL2_CACHE_ASSOC, 16);
+#endif
+    }
+    MPI_Bcast(geometry, 3, MPI_LONG_LONG, 0, CART_COMM);
+
+    stride_padding = pad;
+    cache_line     = geometry[0];
+    cache_way[0]   = std::max(geometry[1], geometry[0]);
+    cache_way[1]   = std::max(geometry[2], geometry[0]);
+    node_bytes[1]  = Q * sizeof(double);
+}
+
+// true if addresses 1 and 2 strides apart fall at least a cache line away from the same set in L1 and L2
+
+static bool conflictFree(const long long bytes)
+{
+    for(int c = 0; c < 2; c++) {
+        for(int t = 1; t <= 2; t++) {
+            long long r = (t * bytes) % cache_way[c];
+            if(r < cache_line || cache_way[c] - r < cache_line) return false;
+        }
+    }
+    return true;
+}
+
+// smallest length >= "length" whose stride of length * nodes nodes is conflict free for scalar and PDF fields
+
+static long long padLength(const long long length, const long long nodes)
+{
+    if(!stride_padding) return length;
+
+    for(long long m = length; m < length + 64; m++)
+    {
+        if(conflictFree(m * nodes * node_bytes[0]) && conflictFree(m * nodes * node_bytes[1])) return m;
+    }
+    return length;   // no short padding helps (e.g. the row stride alone is a multiple of the way size)
+}
+
+long long strideX(const int nn, const int NX)
+{
+    return padLength(nn + NX + nn, 1);
+}
+
+long long strideY(const int nn, const int NX, const int NY)
+{
+    return padLength(nn + NY + nn, strideX(nn, NX));
+}
+
+// print the strides of the local fields
+
+void strideReport(const int nn, const int LX, const int LY, const int myid)
+{
+    if(myid != 0) return;
+
+    std::cout << "array strides           : " << strideX(nn, LX) << " x " << strideY(nn, LX, LY)
+              << " nodes per row x rows per plane (unpadded " << nn + LX + nn << " x " << nn + LY + nn
+              << ", L1/L2 way " << cache_way[0] << "/" << cache_way[1] << " B, rank 0)" << std::endl;
+}
+
+// print how the fields are backed and whether the time loop had to allocate
+
+void arenaReport(const lattice_arena & arena, const long long loop_allocations, const int myid, const MPI_Comm CART_COMM)
+{
+    long long total = 0;
+    MPI_Reduce(&loop_allocations, &total, 1, MPI_LONG_LONG, MPI_SUM, 0, CART_COMM);
+
+    if(myid != 0) return;
+
+    const char* names[] = {"default pages", "transparent huge pages", "explicit huge pages"};
+    std::cout << std::endl;
+    std::cout << "lattice arena           : " << arena.used / (1024.0*1024.0) << " MB in one slab, "
+              << names[arena.pages];
+    if(arena.numa_node >= 0) std::cout << ", bound to NUMA node " << arena.numa_node;
+    std::cout << " (rank 0)" << std::endl;
+    std::cout << "workspace allocations   : " << total << " inside the time loop (all ranks, after step 1)" << std::endl;
+}
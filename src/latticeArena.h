@@ -0,0 +1,56 @@
+#ifndef LATTICE_ARENA_H
+#define LATTICE_ARENA_H
+
+#include <iostream>
+#include <cstddef>    // size_t
+#include <cstdlib>    // posix_memalign, free
+#include <mutex>      // std::mutex
+#include <algorithm>  // std::max
+#include <mpi.h>      // MPI header files
+
+// page backing requested for the arena and the workspace buffers
+
+enum
+{
+    ARENA_PAGES_DEFAULT     = 0,   // ordinary pages
+    ARENA_PAGES_TRANSPARENT = 1,   // ask the kernel for transparent huge pages (madvise)
+    ARENA_PAGES_EXPLICIT    = 2    // explicit huge pages (MAP_HUGETLB), falls back to transparent
+};
+
+// reusable scratch buffers of the hot path (one slot per user, never shared between threads)
+
+enum
+{
+    WORKSPACE_PDF3D       = 0,   // one PDF direction with ghost layers (exchangePDF)
+    WORKSPACE_HALO_VALUES = 1,   // values of one halo message (haloSendrecv)
+    WORKSPACE_HALO_SEND   = 2,   // encoded outgoing halo message
+    WORKSPACE_HALO_RECV   = 3,   // encoded incoming halo message
+    WORKSPACE_PSI_PLANES  = 4,   // ring of psi planes (calc_dPdtWindow, collideFused)
+    WORKSPACE_FORCE_CHECK = 5,   // full-stencil forces (narrowBandCheck)
+    WORKSPACE_SLOTS       = 6
+};
+
+// one slab holding every lattice field of this process
+
+struct lattice_arena
+{
+    char   *base;          // start of the slab (64-byte aligned)
+    size_t  capacity;      // bytes mapped
+    size_t  used;          // bytes handed out so far
+    bool    mapped;        // slab comes from mmap (otherwise posix_memalign)
+    int     pages;         // ARENA_PAGES_* actually in effect
+    int     numa_node;     // memory bound to this NUMA node (-1: no binding)
+};
+
+// scratch buffer of at least "bytes" for one WORKSPACE_* slot (see latticeArena.cpp)
+
+extern void* workspace(const int slot, const size_t bytes);
+
+// strides of a field with ghost layers: nodes per row (X) and rows per plane (Y),
+// padded beyond nn+NX+nn and nn+NY+nn when stride padding is enabled
+
+extern long long strideX(const int nn, const int NX);
+
+extern long long strideY(const int nn, const int NX, const int NY);
+
+#endif
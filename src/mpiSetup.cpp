@@ -64,10 +64,16 @@ void mpiSetup (int argc,               // argc is short for argument count (set
                int* nbr_SOUTH,         // pointer to --> ID of neighboring process to my south  (i,j-1,k)
                int* nbr_NORTH,         // pointer to --> ID of neighboring process to my north  (i,j+1,k)
                int* nbr_BOTTOM,        // pointer to --> ID of neighboring process to my bottom (i,j,k-1)
-               int* nbr_TOP)           // pointer to --> ID of neighboring process to my top    (i,j,k+1)
+               int* nbr_TOP,           // pointer to --> ID of neighboring process to my top    (i,j,k+1)
+               const int thread_required,  // level of thread support requested from MPI (MPI_THREAD_SINGLE, ..., MPI_THREAD_MULTIPLE)
+               int* thread_provided,   // pointer to --> level of thread support provided by the MPI library
+               const int io_ratio,     // world ranks per I/O server (0 = no I/O servers)
+               io_server & io)         // I/O server split (I/O server ranks return without a CART_COMM)
 {
     // Initialize MPI
-    MPI_Init(&argc, &argv);                     // number and value of command-line arguments
+    MPI_Init_thread(&argc, &argv,               // number and value of command-line arguments
+                    thread_required,            // requested level of thread support
+                    thread_provided);           // level of thread support actually provided
     MPI_Comm_size(MPI_COMM_WORLD, numprocs);    // get the total number of MPI processes
     MPI_Comm_rank(MPI_COMM_WORLD, myid);        // get my process ID
 
@@ -96,9 +102,26 @@ void mpiSetup (int argc,               // argc is short for argument count (set
     dims[1] = atoi(argv[2]);  // convert character to integer - domain partitions along Y
     dims[2] = atoi(argv[3]);  // convert character to integer - domain partitions along Z
 
+    // optionally set aside I/O server ranks, the remaining (compute) ranks form the Cartesian topology
+    MPI_Comm COMPUTE_COMM;
+    ioServerSplit(io, io_ratio, COMPUTE_COMM);
+    if(io.server)
+    {
+        CART_COMM = MPI_COMM_NULL;
+        return;
+    }
+    MPI_Comm_size(COMPUTE_COMM, numprocs);
+
+    if(dims[0]*dims[1]*dims[2] != *numprocs)
+    {
+        if(*myid == 0) std::cout << "ERROR: " << dims[0] << " x " << dims[1] << " x " << dims[2] << " partitions for "
+                                 << *numprocs << " compute ranks" << std::endl;
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
     // create a new communicator (CART_COMM) with Cartesian topology
     int reorder = 1;
-    MPI_Cart_create(MPI_COMM_WORLD, ndims, dims, periods, reorder, &CART_COMM);
+    MPI_Cart_create(COMPUTE_COMM, ndims, dims, periods, reorder, &CART_COMM);
 
     // get my position in the new communicator
     MPI_Comm_rank(CART_COMM,myid);
@@ -7,4 +7,8 @@
       #include <sstream>
       #include <iomanip>
 
+      #include "ioServer.h"   // io_server
+
+      extern void ioServerSplit(io_server & io, const int ratio, MPI_Comm & COMPUTE_COMM);
+
 #endif
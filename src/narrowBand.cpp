@@ -0,0 +1,234 @@
+#include "narrowBand.h"
+
+/**
+Narrow-band evaluation of the cohesive force
+
+The Shan-Chen force at a node is a sum of psi(rho[N]) * psi(rho[Nflow]) over
+the D3Q19 stencil. Where rho is locally uniform the contributions of opposite
+directions cancel and the force is zero, which after phase separation is true
+almost everywhere except near the liquid-vapor interfaces.
+
+The band is the set of interior nodes within "width" lattice units of a node
+whose rho, u, v or w differs from one of its neighbors by more than tol. Every
+step only the previous band (plus the interior nodes next to the process
+boundary, where changes coming from neighboring processes first show up) is
+scanned for such nodes, and the band is regrown around them. Since a
+disturbance travels at most one node per step, it is always caught while it
+is still inside the scanned region.
+
+The force is evaluated with the same stencil as calc_dPdt on band nodes only;
+dPdt is zero everywhere else.
+*/
+
+// start with every interior node in the band (the first step is a full evaluation)
+
+void narrowBandSetup(narrow_band & band,
+                     const int     nn,       // ghost layer thickness
+                     const int     NX,       // local nodes along X
+                     const int     NY,       // local nodes along Y
+                     const int     NZ,       // local nodes along Z
+                     const int     width,    // lattice units kept around the interface
+                     const double  tol)      // uniformity tolerance
+{
+    const long long GX = strideX(nn, NX);
+    const long long GY = strideY(nn, NX, NY);
+    const long long GZ = nn + NZ + nn;
+
+    band.width      = width;
+    band.tol        = tol;
+    band.pass       = 0;
+    band.interior   = (long long) NX * NY * NZ;
+    band.band_nodes = 0;
+    band.steps      = 0;
+    band.max_error  = 0.;
+    band.checks     = 0;
+    band.time       = 0.;
+
+    band.mark.assign(GX*GY*GZ, 0);
+    band.nodes.clear();
+    band.shell.clear();
+
+    for(int k = 0; k < NZ; k++) {
+        for(int j = 0; j < NY; j++) {
+            for(int i = 0; i < NX; i++) {
+                long long N = (nn + i) + GX*(nn + j) + GX*GY*(nn + k);
+                band.nodes.push_back(N);
+                if(i == 0 || i == NX-1 || j == 0 || j == NY-1 || k == 0 || k == NZ-1) band.shell.push_back(N);
+            }
+        }
+    }
+}
+
+// update the band and calculate the change in momentum because of inter-particle forces on it
+
+void calc_dPdtBand(narrow_band & band,
+                   const int nn, const int NX, const int NY, const int NZ,
+                   double* ex, double* ey, double* ez, double* G11,
+                   double* rho, double* u, double* v, double* w,
+                   double* dPdt_x, double* dPdt_y, double* dPdt_z)
+{
+    double t_beg = MPI_Wtime();
+
+    const long long GX = strideX(nn, NX);
+    const long long GY = strideY(nn, NX, NY);
+    const double tol = band.tol;
+
+    long long offset[19];
+    for(int id = 0; id < 19; id++) offset[id] = (long long) ex[id] + GX*((long long) ey[id]) + GX*GY*((long long) ez[id]);
+
+    // mark values for this step (nodes scanned, nodes in the new band)
+    band.pass += 2;
+    const int scanned = band.pass;
+    const int in_band = band.pass + 1;
+
+    // 1. non-uniform nodes among the previous band and the process boundary shell
+
+    std::vector<long long> & core = band.core;
+    core.clear();
+    auto scan = [&](const long long N)
+    {
+        if(band.mark[N] == scanned) return;
+        band.mark[N] = scanned;
+        for(int id = 1; id < 19; id++)
+        {
+            long long M = N + offset[id];
+            if(fabs(rho[M] - rho[N]) > tol || fabs(u[M] - u[N]) > tol ||
+               fabs(v[M] - v[N])     > tol || fabs(w[M] - w[N]) > tol)
+            {
+                core.push_back(N);
+                return;
+            }
+        }
+    };
+    for(size_t n = 0; n < band.nodes.size(); n++) scan(band.nodes[n]);
+    for(size_t n = 0; n < band.shell.size(); n++) scan(band.shell[n]);
+
+    // 2. nodes leaving the band feel no force
+
+    for(size_t n = 0; n < band.nodes.size(); n++)
+    {
+        long long N = band.nodes[n];
+        dPdt_x[N] = 0.;
+        dPdt_y[N] = 0.;
+        dPdt_z[N] = 0.;
+    }
+
+    // 3. grow the new band layer by layer around the non-uniform nodes (interior nodes only)
+
+    band.nodes.clear();
+    for(size_t n = 0; n < core.size(); n++)
+    {
+        band.mark[core[n]] = in_band;
+        band.nodes.push_back(core[n]);
+    }
+
+    size_t layer_beg = 0;
+    for(int layer = 0; layer < band.width; layer++)
+    {
+        size_t layer_end = band.nodes.size();
+        for(size_t n = layer_beg; n < layer_end; n++)
+        {
+            long long N = band.nodes[n];
+            int I = (int) (N % GX);
+            int J = (int) ((N / GX) % GY);
+            int K = (int) (N / (GX*GY));
+            for(int id = 1; id < 19; id++)
+            {
+                int i = I - nn + (int) ex[id];
+                int j = J - nn + (int) ey[id];
+                int k = K - nn + (int) ez[id];
+                if(i < 0 || i >= NX || j < 0 || j >= NY || k < 0 || k >= NZ) continue;
+
+                long long M = N + offset[id];
+                if(band.mark[M] != in_band)
+                {
+                    band.mark[M] = in_band;
+                    band.nodes.push_back(M);
+                }
+            }
+        }
+        layer_beg = layer_end;
+    }
+
+    // 4. interparticle forces on the band (same stencil as calc_dPdt)
+
+    for(size_t n = 0; n < band.nodes.size(); n++)
+    {
+        long long N = band.nodes[n];
+        double psi_N = psi(rho[N]);
+        double Gsumx = 0.;
+        double Gsumy = 0.;
+        double Gsumz = 0.;
+        for(int id = 0; id < 19; id++)
+        {
+            double strength = psi_N * psi(rho[N + offset[id]]) * G11[id];
+
+            Gsumx += strength * ex[id];
+            Gsumy += strength * ey[id];
+            Gsumz += strength * ez[id];
+        }
+        dPdt_x[N] = -Gsumx;
+        dPdt_y[N] = -Gsumy;
+        dPdt_z[N] = -Gsumz;
+    }
+
+    band.band_nodes += (long long) band.nodes.size();
+    band.steps++;
+    band.time += MPI_Wtime() - t_beg;
+}
+
+// compare the narrow-band forces with a full-stencil evaluation of the same density field
+
+void narrowBandCheck(narrow_band & band,
+                     const int nn, const int NX, const int NY, const int NZ,
+                     double* ex, double* ey, double* ez, double* G11,
+                     double* rho, const double* dPdt_x, const double* dPdt_y, const double* dPdt_z)
+{
+    const long long GX = strideX(nn, NX);
+    const long long GY = strideY(nn, NX, NY);
+    const long long GZ = nn + NZ + nn;
+
+    double *full_x = (double*) workspace(WORKSPACE_FORCE_CHECK, 3 * GX*GY*GZ * sizeof(double));
+    double *full_y = full_x + GX*GY*GZ;
+    double *full_z = full_y + GX*GY*GZ;
+
+    calc_dPdt(nn, NX, NY, NZ, ex, ey, ez, G11, rho, full_x, full_y, full_z);
+
+    for(int k = 0; k < NZ; k++) {
+        for(int j = 0; j < NY; j++) {
+            for(int i = 0; i < NX; i++) {
+                long long N = (nn + i) + GX*(nn + j) + GX*GY*(nn + k);
+                band.max_error = std::max(band.max_error, fabs(dPdt_x[N] - full_x[N]));
+                band.max_error = std::max(band.max_error, fabs(dPdt_y[N] - full_y[N]));
+                band.max_error = std::max(band.max_error, fabs(dPdt_z[N] - full_z[N]));
+            }
+        }
+    }
+    band.checks++;
+}
+
+// print the average band size, the force error and the time spent
+
+void narrowBandReport(const narrow_band & band, const int myid, const MPI_Comm CART_COMM)
+{
+    long long local_nodes[2] = {band.band_nodes, band.interior * band.steps};
+    long long total_nodes[2] = {0, 0};
+    MPI_Reduce(local_nodes, total_nodes, 2, MPI_LONG_LONG, MPI_SUM, 0, CART_COMM);
+
+    double local_max[2] = {band.max_error, band.time};
+    double global_max[2] = {0., 0.};
+    MPI_Reduce(local_max, global_max, 2, MPI_DOUBLE, MPI_MAX, 0, CART_COMM);
+
+    if(myid != 0) return;
+
+    std::cout << std::endl;
+    std::cout << "narrow band width       : " << band.width << " (tol = " << band.tol << ")" << std::endl;
+    if(total_nodes[1] > 0)
+    {
+        std::cout << "average band size       : " << 100.0 * total_nodes[0] / total_nodes[1]
+                  << " % of the interior nodes" << std::endl;
+    }
+    std::cout << "time in calc_dPdtBand   : " << global_max[1] << " s (slowest rank)" << std::endl;
+    std::cout << "max. force error        : " << global_max[0]
+              << " vs. full stencil (" << band.checks << " checks)" << std::endl;
+}
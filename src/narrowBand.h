@@ -0,0 +1,38 @@
+#ifndef NARROW_BAND_H
+#define NARROW_BAND_H
+
+#include <iostream>
+#include <vector>
+#include <cmath>      // fabs
+#include <mpi.h>      // MPI header files
+
+#include "latticeArena.h"  // workspace, strideX, strideY
+
+// nodes near a liquid-vapor interface, the only place where the cohesive force is evaluated
+
+struct narrow_band
+{
+    int               width;        // lattice units kept around every non-uniform node
+    double            tol;          // max. difference of rho, u, v, w to a neighbor for a node to count as uniform
+    std::vector<long long> nodes;   // band nodes (index N including ghost layers)
+    std::vector<long long> shell;   // interior nodes next to the process boundary (always re-checked)
+    std::vector<long long> core;    // non-uniform nodes found in the current step (kept to reuse its storage)
+    std::vector<int>  mark;         // per node: last pass that visited it (see calc_dPdtBand)
+    int               pass;         // pass counter used with mark
+    long long         interior;     // interior nodes of this process
+    long long         band_nodes;   // band sizes summed over all steps
+    long long         steps;        // force evaluations done in narrow-band mode
+    double            max_error;    // largest |dPdt(band) - dPdt(full)| found by narrowBandCheck
+    int               checks;       // number of accuracy checks done
+    double            time;         // wall clock time spent in calc_dPdtBand
+};
+
+// full-stencil kernel (see calc_dPdt.cpp)
+
+extern double psi(double x);
+
+extern void calc_dPdt(const int nn, const int NX, const int NY, const double NZ,
+                      double* ex, double* ey, double* ez, double* G11,
+                      double* rho, double* dPdt_x, double* dPdt_y, double* dPdt_z);
+
+#endif
@@ -0,0 +1,156 @@
+#include "nonTemporal.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>        // sysconf (last-level cache size)
+#endif
+
+/**
+Streaming (non-temporal) stores for write-only outputs
+
+streaming() overwrites every interior node of f_new, and updateEquilibrium()
+(or collideFused) every interior node of f_eq, without reading them. A
+regular store first reads the cache line it writes to (read-for-ownership),
+so such an output costs twice its size in memory traffic. A streaming store
+writes whole lines straight to memory instead.
+
+The kernels compute one row of nodes (19 contiguous values per node) into a
+small thread-local buffer and stream the row out. This is only worthwhile
+when the output does not fit in the last-level cache anyway; otherwise the
+next kernel would have found it in cache. NT_STORES_AUTO therefore compares
+the size of the output with the cache.
+
+prefetch_distance (nodes ahead, 0 = off) adds software prefetches for the
+nine source pencils streaming() reads from f and f_eq, which are more
+concurrent read streams than the hardware prefetchers track.
+
+Every kernel records its time and traffic, and trafficReport prints the
+bandwidth achieved and the read-for-ownership traffic avoided.
+*/
+
+static int       store_mode        = NT_STORES_OFF;
+static int       prefetch_distance = 0;
+static long long cache_bytes       = 32 * 1024 * 1024;   // last-level cache (fallback if unknown)
+
+static kernel_traffic traffic[TRAFFIC_KERNELS];
+
+void storeSetup(const int mode, const int distance)
+{
+    store_mode        = mode;
+    prefetch_distance = distance;
+
+#if defined(_SC_LEVEL3_CACHE_SIZE) && defined(_SC_LEVEL2_CACHE_SIZE)
+    long long l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    long long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if(l3 > 0)      cache_bytes = l3;
+    else if(l2 > 0) cache_bytes = l2;
+#endif
+
+    for(int k = 0; k < TRAFFIC_KERNELS; k++)
+    {
+        traffic[k].nanoseconds    = 0;
+        traffic[k].bytes_read     = 0;
+        traffic[k].bytes_written  = 0;
+        traffic[k].bytes_streamed = 0;
+    }
+}
+
+// switch the store mode only (the autotuner tries the modes in turn; the traffic counters keep running)
+
+void storeMode(const int mode)
+{
+    store_mode = mode;
+}
+
+// should an output of "bytes" that is written but never read by the kernel use streaming stores?
+
+bool streamingStores(const long long bytes)
+{
+#ifdef __SSE2__
+    if(store_mode == NT_STORES_ON)   return true;
+    if(store_mode == NT_STORES_AUTO) return bytes > cache_bytes;
+#endif
+    return false;
+}
+
+int prefetchDistance()
+{
+    return prefetch_distance;
+}
+
+// row buffer of at least "count" values for the calling thread (grows once, then reused)
+
+double* storeRow(const long long count)
+{
+    thread_local std::vector<double> row;
+    if((long long) row.size() < count) row.resize(count);
+    return row.data();
+}
+
+// dst[0 .. count) = src[0 .. count), bypassing the caches where dst is 16-byte aligned
+
+void streamStore(double* dst, const double* src, const long long count)
+{
+#ifdef __SSE2__
+    long long n = 0;
+    for(; n < count && ((uintptr_t) (dst + n) & 15); n++) dst[n] = src[n];
+    for(; n + 2 <= count; n += 2) _mm_stream_pd(dst + n, _mm_loadu_pd(src + n));
+    for(; n < count; n++) dst[n] = src[n];
+#else
+    memcpy(dst, src, count * sizeof(double));
+#endif
+}
+
+// make streaming stores visible before the data is read by another thread or sent
+
+void storeFence()
+{
+#ifdef __SSE2__
+    _mm_sfence();
+#endif
+}
+
+void trafficAdd(const int kernel, const std::chrono::steady_clock::time_point t_beg,
+                const long long bytes_read, const long long bytes_written, const bool streamed)
+{
+    kernel_traffic & k = traffic[kernel];
+    k.nanoseconds    += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t_beg).count();
+    k.bytes_read     += bytes_read;
+    k.bytes_written  += bytes_written;
+    if(streamed) k.bytes_streamed += bytes_written;
+}
+
+// print the bandwidth of every kernel and the read-for-ownership traffic avoided
+
+void trafficReport(const int myid, const MPI_Comm CART_COMM)
+{
+    long long local[4*TRAFFIC_KERNELS], total[4*TRAFFIC_KERNELS];
+    for(int k = 0; k < TRAFFIC_KERNELS; k++)
+    {
+        local[4*k + 0] = traffic[k].nanoseconds;
+        local[4*k + 1] = traffic[k].bytes_read;
+        local[4*k + 2] = traffic[k].bytes_written;
+        local[4*k + 3] = traffic[k].bytes_streamed;
+    }
+    MPI_Reduce(local, total, 4*TRAFFIC_KERNELS, MPI_LONG_LONG, MPI_SUM, 0, CART_COMM);
+
+    if(myid != 0) return;
+
+    const char* names[] = {"streaming      ", "equilibrium    ", "copy f_new -> f"};
+    const char* modes[] = {"off", "on", "auto"};
+    const double GB = 1.0e9;
+
+    std::cout << std::endl;
+    std::cout << "streaming stores        : " << modes[store_mode] << " (last-level cache " << cache_bytes / (1024*1024)
+              << " MB, prefetch distance " << prefetch_distance << " nodes)" << std::endl;
+    for(int k = 0; k < TRAFFIC_KERNELS; k++)
+    {
+        double seconds  = total[4*k] * 1.0e-9;
+        double moved    = (double) total[4*k + 1] + total[4*k + 2];
+        double rfo      = (double) total[4*k + 2] - total[4*k + 3];   // lines still read before being written
+        if(seconds <= 0.) continue;
+
+        std::cout << "  " << names[k] << " : " << (moved + rfo) / seconds / GB << " GB/s incl. read-for-ownership ("
+                  << seconds << " s summed over ranks), " << total[4*k + 3] / GB
+                  << " GB of read-for-ownership avoided" << std::endl;
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef NON_TEMPORAL_H
+#define NON_TEMPORAL_H
+
+#include <iostream>
+#include <vector>
+#include <atomic>     // std::atomic
+#include <chrono>     // std::chrono::steady_clock
+#include <cstring>    // memcpy
+#include <cstdint>    // uintptr_t
+#include <mpi.h>      // MPI header files
+
+#ifdef __SSE2__
+#include <emmintrin.h>   // _mm_stream_pd, _mm_sfence
+#endif
+
+// when write-only lattice outputs bypass the caches
+
+enum
+{
+    NT_STORES_OFF  = 0,   // always regular stores
+    NT_STORES_ON   = 1,   // always streaming stores
+    NT_STORES_AUTO = 2    // streaming stores for outputs larger than the last-level cache
+};
+
+// kernels whose memory traffic is recorded
+
+enum
+{
+    TRAFFIC_STREAMING   = 0,   // streaming: reads f, f_eq, writes f_new
+    TRAFFIC_EQUILIBRIUM = 1,   // updateEquilibrium / collideFused: writes f_eq
+    TRAFFIC_COPY        = 2,   // f_new copied back to f
+    TRAFFIC_KERNELS     = 3
+};
+
+// memory traffic of one kernel (updated by every thread running it)
+
+struct kernel_traffic
+{
+    std::atomic<long long> nanoseconds;   // time spent in the kernel
+    std::atomic<long long> bytes_read;    // bytes the kernel has to load
+    std::atomic<long long> bytes_written; // bytes the kernel stores
+    std::atomic<long long> bytes_streamed;// part of bytes_written stored with streaming stores (no read-for-ownership)
+};
+
+// settings and per-kernel traffic (see nonTemporal.cpp)
+
+extern bool streamingStores(const long long bytes);
+
+extern int prefetchDistance();
+
+extern double* storeRow(const long long count);
+
+extern void streamStore(double* dst, const double* src, const long long count);
+
+extern void storeFence();
+
+extern void trafficAdd(const int kernel, const std::chrono::steady_clock::time_point t_beg,
+                       const long long bytes_read, const long long bytes_written, const bool streamed);
+
+#endif
@@ -0,0 +1,258 @@
+#include "outputCodec.h"
+
+/**
+Chunked and compressed output datasets
+
+After phase separation rho is nearly bimodal, so the fields compress well.
+With OUTPUT_FILTER_DEFLATE every dataset is stored in chunks of about 1 MB
+(whole XY-planes) passed through the byte-shuffle and deflate filters, which
+any HDF5 reader decodes transparently.
+
+tol > 0 adds an error-bounded lossy step in front of the filters: every value
+is rounded to the nearest multiple of the largest power of two not exceeding
+2*tol. The error stays below tol and the rounded values end in long runs of
+zero mantissa bits, which shuffle + deflate squeeze out. The data is still
+stored as plain doubles.
+
+With benchmark set, every frame of a rank is additionally written to a
+scratch file once per row of bench_settings, and the end-of-run report
+lists compression ratio against write time for each.
+*/
+
+struct bench_setting
+{
+    int         filter;
+    int         level;
+    double      tol;
+    const char* name;
+};
+
+static const bench_setting bench_settings[] =
+{
+    {OUTPUT_FILTER_NONE,    0, 0.,   "contiguous             "},
+    {OUTPUT_FILTER_DEFLATE, 1, 0.,   "shuffle+deflate 1      "},
+    {OUTPUT_FILTER_DEFLATE, 6, 0.,   "shuffle+deflate 6      "},
+    {OUTPUT_FILTER_DEFLATE, 1, 1e-9, "quantize 1e-9 + defl. 1"},
+    {OUTPUT_FILTER_DEFLATE, 1, 1e-6, "quantize 1e-6 + defl. 1"},
+    {OUTPUT_FILTER_DEFLATE, 1, 1e-3, "quantize 1e-3 + defl. 1"}
+};
+static const int bench_count = sizeof(bench_settings) / sizeof(bench_setting);
+
+void outputCodecSetup(output_codec & codec, const int filter, const int level, const double tol, const bool benchmark)
+{
+    codec.filter       = filter;
+    codec.level        = level;
+    codec.tol          = tol;
+    codec.benchmark    = benchmark;
+    codec.datasets     = 0;
+    codec.bytes_raw    = 0.;
+    codec.bytes_stored = 0.;
+    codec.time         = 0.;
+    codec.bench_raw.assign(bench_count, 0.);
+    codec.bench_stored.assign(bench_count, 0.);
+    codec.bench_time.assign(bench_count, 0.);
+    codec.bench_error.assign(bench_count, 0.);
+}
+
+// round every value to a multiple of a power of two <= 2*tol; returns the largest change
+
+static double quantize(double* values, const long long count, const double tol)
+{
+    int e;
+    frexp(2*tol, &e);
+    const double step = ldexp(1.0, e - 1);   // 2^(e-1) <= 2*tol < 2^e
+
+    double max_error = 0.;
+    for(long long n = 0; n < count; n++)
+    {
+        double q = nearbyint(values[n] / step) * step;
+        max_error = std::max(max_error, fabs(q - values[n]));
+        values[n] = q;
+    }
+    return max_error;
+}
+
+// interior LX x LY x LZ of a ghosted (and padded) field, quantized, in codec.packed
+// (NULL if the codec is lossless: the field can then be written straight from memory)
+
+const double* outputCodecPack(output_codec & codec, const double* field, const long long SX, const long long SY,
+                              const int nn, const int LX, const int LY, const int LZ, const int myid)
+{
+    if(codec.tol <= 0. && !codec.benchmark) return NULL;
+
+    codec.packed.resize((long long) LX*LY*LZ);
+    long long n = 0;
+    for(int k = 0; k < LZ; k++) {
+        for(int j = 0; j < LY; j++) {
+            const double *row = field + (nn + SX*(nn + j) + SX*SY*(nn + k));
+            for(int i = 0; i < LX; i++) codec.packed[n++] = row[i];
+        }
+    }
+    if(codec.benchmark) outputCodecBenchmark(codec, codec.packed.data(), LX, LY, LZ, myid);
+    if(codec.tol <= 0.) return NULL;
+
+    quantize(codec.packed.data(), n, codec.tol);
+    return codec.packed.data();
+}
+
+// quantize an already packed field in place (I/O servers)
+
+void outputCodecQuantize(const output_codec & codec, double* values, const long long count)
+{
+    if(codec.tol > 0.) quantize(values, count, codec.tol);
+}
+
+// dataset creation properties: contiguous, or ~1 MB chunks of whole planes with shuffle + deflate
+
+static hid_t creationProperties(const int filter, const int level, const hsize_t* dims)
+{
+    hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+    if(filter == OUTPUT_FILTER_DEFLATE)
+    {
+        hsize_t plane    = dims[1] * dims[2];
+        hsize_t planes   = std::max((hsize_t) 1, (hsize_t) (1 << 17) / plane);   // 2^17 doubles = 1 MB
+        hsize_t chunk[3] = {std::min(planes, dims[0]), dims[1], dims[2]};
+        H5Pset_chunk(dcpl, 3, chunk);
+        H5Pset_shuffle(dcpl);
+        H5Pset_deflate(dcpl, level);
+    }
+    return dcpl;
+}
+
+// create a 3D dataset of little-endian doubles with the storage settings of the codec
+
+hid_t outputCodecCreate(const output_codec & codec, const hid_t location, const char* name, const hsize_t* dims)
+{
+    hid_t dataspace = H5Screate_simple(3, dims, NULL);
+    hid_t dcpl      = creationProperties(codec.filter, codec.level, dims);
+    hid_t dataset   = H5Dcreate2(location, name, H5T_IEEE_F64LE, dataspace, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+    H5Pclose(dcpl);
+    H5Sclose(dataspace);
+    return dataset;
+}
+
+// create a dataset of little-endian doubles growing by one LZ x LY x LX frame at a time
+// (unlimited leading dimension, one chunk per frame, filtered like the other datasets)
+
+hid_t outputCodecCreateSeries(const output_codec & codec, const hid_t location, const char* name, const hsize_t* frame_dims)
+{
+    hsize_t dims[4]    = {0, frame_dims[0], frame_dims[1], frame_dims[2]};
+    hsize_t maxdims[4] = {H5S_UNLIMITED, frame_dims[0], frame_dims[1], frame_dims[2]};
+
+    // chunks stay below the 4 GB limit of HDF5 (whole planes, split along Z only for huge frames)
+    hsize_t plane    = frame_dims[1] * frame_dims[2];
+    hsize_t planes   = std::max((hsize_t) 1, (hsize_t) (1 << 28) / plane);   // 2^28 doubles = 2 GB
+    hsize_t chunk[4] = {1, std::min(planes, frame_dims[0]), frame_dims[1], frame_dims[2]};
+
+    hid_t dataspace = H5Screate_simple(4, dims, maxdims);
+    hid_t dcpl      = H5Pcreate(H5P_DATASET_CREATE);
+    H5Pset_chunk(dcpl, 4, chunk);
+    if(codec.filter == OUTPUT_FILTER_DEFLATE)
+    {
+        H5Pset_shuffle(dcpl);
+        H5Pset_deflate(dcpl, codec.level);
+    }
+    hid_t dataset   = H5Dcreate2(location, name, H5T_IEEE_F64LE, dataspace, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+    H5Pclose(dcpl);
+    H5Sclose(dataspace);
+    return dataset;
+}
+
+// account for a dataset written in "seconds" (call before closing it)
+
+void outputCodecRecord(output_codec & codec, const hid_t dataset, const double raw_bytes, const double seconds)
+{
+    codec.datasets++;
+    codec.bytes_raw    += raw_bytes;
+    codec.bytes_stored += H5Dget_storage_size(dataset);
+    codec.time         += seconds;
+}
+
+// write one packed LX x LY x LZ field with every benchmark setting to a scratch file
+
+void outputCodecBenchmark(output_codec & codec, const double* packed, const int LX, const int LY, const int LZ,
+                          const int myid)
+{
+    const long long count = (long long) LX*LY*LZ;
+    std::vector<double> values(count);
+    hsize_t dims[3] = {(hsize_t) LZ, (hsize_t) LY, (hsize_t) LX};
+
+    std::stringstream file_name;
+    file_name << "../out/hdf5/benchmark_" << myid << ".h5";
+
+    for(int s = 0; s < bench_count; s++)
+    {
+        const bench_setting & b = bench_settings[s];
+        std::copy(packed, packed + count, values.begin());
+
+        double t_beg = MPI_Wtime();
+        double error = (b.tol > 0.) ? quantize(values.data(), count, b.tol) : 0.;
+        hid_t file_id   = H5Fcreate(file_name.str().c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+        hid_t dataspace = H5Screate_simple(3, dims, NULL);
+        hid_t dcpl      = creationProperties(b.filter, b.level, dims);
+        hid_t dataset   = H5Dcreate2(file_id, "/rho", H5T_IEEE_F64LE, dataspace, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+        H5Dwrite(dataset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, values.data());
+        double stored = H5Dget_storage_size(dataset);
+        H5Dclose(dataset);
+        H5Pclose(dcpl);
+        H5Sclose(dataspace);
+        H5Fclose(file_id);
+
+        codec.bench_time[s]   += MPI_Wtime() - t_beg;
+        codec.bench_raw[s]    += count * sizeof(double);
+        codec.bench_stored[s] += stored;
+        codec.bench_error[s]   = std::max(codec.bench_error[s], error);
+    }
+    remove(file_name.str().c_str());
+}
+
+// print compression ratio and write time (and the benchmark table if requested)
+
+void outputCodecReport(const output_codec & codec, const int myid, const MPI_Comm comm)
+{
+    double local_stats[2] = {codec.bytes_raw, codec.bytes_stored};
+    double global_stats[2];
+    MPI_Reduce(local_stats, global_stats, 2, MPI_DOUBLE, MPI_SUM, 0, comm);
+
+    double max_time = 0.;
+    MPI_Reduce(&codec.time, &max_time, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+
+    std::vector<double> bench(3*bench_count, 0.), bench_total(3*bench_count, 0.), bench_error(bench_count, 0.);
+    if(codec.benchmark)
+    {
+        for(int s = 0; s < bench_count; s++)
+        {
+            bench[3*s + 0] = codec.bench_raw[s];
+            bench[3*s + 1] = codec.bench_stored[s];
+            bench[3*s + 2] = codec.bench_time[s];
+        }
+        MPI_Reduce(bench.data(), bench_total.data(), 3*bench_count, MPI_DOUBLE, MPI_SUM, 0, comm);
+        MPI_Reduce(codec.bench_error.data(), bench_error.data(), bench_count, MPI_DOUBLE, MPI_MAX, 0, comm);
+    }
+
+    if(myid != 0) return;
+
+    const char* filters[] = {"none", "shuffle+deflate"};
+    std::cout << std::endl;
+    std::cout << "output datasets         : " << filters[codec.filter];
+    if(codec.filter == OUTPUT_FILTER_DEFLATE) std::cout << " (level " << codec.level << ")";
+    if(codec.tol > 0.) std::cout << ", quantized to " << codec.tol;
+    std::cout << std::endl;
+    if(global_stats[1] > 0.)
+    {
+        std::cout << "output compression ratio: " << global_stats[0] / global_stats[1]
+                  << " (" << global_stats[1] / 1.0e6 << " MB stored)" << std::endl;
+    }
+    std::cout << "dataset write time      : " << max_time << " s (slowest rank)" << std::endl;
+
+    if(!codec.benchmark) return;
+
+    std::cout << "output benchmark (summed over ranks and frames):" << std::endl;
+    for(int s = 0; s < bench_count; s++)
+    {
+        double raw = bench_total[3*s], stored = bench_total[3*s + 1], seconds = bench_total[3*s + 2];
+        std::cout << "  " << bench_settings[s].name << " : ratio " << (stored > 0. ? raw / stored : 0.)
+                  << ", write time " << seconds << " s (" << (seconds > 0. ? raw / seconds / 1.0e6 : 0.) << " MB/s)"
+                  << ", max error " << bench_error[s] << std::endl;
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef OUTPUT_CODEC_H
+#define OUTPUT_CODEC_H
+
+#include <iostream>
+#include <vector>
+#include <sstream>
+#include <algorithm>  // std::min, std::max, std::copy
+#include <cstdio>     // remove
+#include <cmath>      // frexp, ldexp, nearbyint
+#include <mpi.h>      // MPI header files
+
+#include "hdf5.h"     // along with HDF5, this automatically includes the necessary mpi header files
+
+// HDF5 filters applied to output datasets
+
+enum
+{
+    OUTPUT_FILTER_NONE    = 0,   // contiguous, uncompressed
+    OUTPUT_FILTER_DEFLATE = 1    // chunked, byte shuffle + deflate (zlib)
+};
+
+// storage settings and running statistics for the output datasets of one rank
+
+struct output_codec
+{
+    int                 filter;        // one of OUTPUT_FILTER_*
+    int                 level;         // deflate level (1 fastest ... 9 smallest)
+    double              tol;           // quantization error bound (0: lossless)
+    bool                benchmark;     // also time every setting of the benchmark table on each frame
+    long long           datasets;      // datasets written
+    double              bytes_raw;     // bytes of the fields written
+    double              bytes_stored;  // bytes the datasets occupy in the files
+    double              time;          // time spent creating and writing datasets
+    std::vector<double> packed;        // interior of a field, quantized (only one thread writes frames at a time)
+    std::vector<double> bench_raw;     // benchmark: raw bytes per setting
+    std::vector<double> bench_stored;  // benchmark: stored bytes per setting
+    std::vector<double> bench_time;    // benchmark: write time per setting
+    std::vector<double> bench_error;   // benchmark: largest quantization error per setting
+};
+
+// dataset creation and quantization used by the writers (see outputCodec.cpp)
+
+extern const double* outputCodecPack(output_codec & codec, const double* field, const long long SX, const long long SY,
+                                     const int nn, const int LX, const int LY, const int LZ, const int myid);
+
+extern void outputCodecQuantize(const output_codec & codec, double* values, const long long count);
+
+extern hid_t outputCodecCreate(const output_codec & codec, const hid_t location, const char* name, const hsize_t* dims);
+
+extern hid_t outputCodecCreateSeries(const output_codec & codec, const hid_t location, const char* name,
+                                     const hsize_t* frame_dims);
+
+extern void outputCodecRecord(output_codec & codec, const hid_t dataset, const double raw_bytes, const double seconds);
+
+extern void outputCodecBenchmark(output_codec & codec, const double* packed, const int LX, const int LY, const int LZ,
+                                 const int myid);
+
+#endif
@@ -19,7 +19,23 @@
                  &dims[0], &coords[0], CART_COMM,
                  &nbr_WEST, &nbr_EAST,
                  &nbr_SOUTH, &nbr_NORTH,
-                 &nbr_BOTTOM, &nbr_TOP);
+                 &nbr_BOTTOM, &nbr_TOP,
+                 (use_comm_thread || use_partitioned_halo || (use_async_output && output_mode == OUTPUT_SHARED)) ? MPI_THREAD_MULTIPLE
+                                                           : (use_blocks ? MPI_THREAD_FUNNELED : MPI_THREAD_SINGLE),
+                 &thread_provided,
+                 io_server_ratio, io);
+
+//      I/O server ranks only receive and write the frames of their compute ranks
+
+        if(io.server)
+        {
+          outputCodecSetup(out_codec, output_filter, output_deflate_level, output_quantize_tol, output_benchmark);
+          ioServerRun(io, delta, out_codec);
+          ioServerReport(io, myid, CART_COMM);
+          outputCodecReport(out_codec, io.server_id, io.IO_COMM);
+          MPI_Finalize();
+          return 0;
+        }
 
 //      calculate size of local 3D sub-domain handled by this rank
 
@@ -47,29 +63,52 @@
 
 //      define local buffers for this MPI rank
 
-        const int size1 = (nn+LX+nn) * (nn+LY+nn) * (nn+LZ+nn);
-        const int size2 = size1 * 19;
+        strideSetup(arena_pad_strides, Q, CART_COMM);
+        storeSetup(nt_stores, nt_prefetch_distance);
 
-        double *rho    = new double[size1]; // density
-        double *u      = new double[size1]; // velocity x-component
-        double *v      = new double[size1]; // velocity y-component
-        double *w      = new double[size1]; // velocity z-component
-        double *dPdt_x = new double[size1]; // momentum change along x
-        double *dPdt_y = new double[size1]; // momentum change along y
-        double *dPdt_z = new double[size1]; // momentum change along z
+        const long long size1 = strideX(nn, LX) * strideY(nn, LX, LY) * (nn+LZ+nn);
+        const long long size2 = size1 * 19;
 
-        double *f      = new double[size2]; // PDF
-        double *f_eq   = new double[size2]; // PDF
-        double *f_new  = new double[size2]; // PDF
+        // one 64-byte aligned slab for all fields (each field may be padded to the next cache line)
+        arenaCreate(arena, (7*size1 + 3*size2 + 10*8) * sizeof(double), arena_pages, arena_numa_node);
+        workspaceSetup(arena_pages);
 
-//      initialize fields
+        double *rho    = arenaAlloc(arena, size1); // density
+        double *u      = arenaAlloc(arena, size1); // velocity x-component
+        double *v      = arenaAlloc(arena, size1); // velocity y-component
+        double *w      = arenaAlloc(arena, size1); // velocity z-component
+        double *dPdt_x = arenaAlloc(arena, size1); // momentum change along x
+        double *dPdt_y = arenaAlloc(arena, size1); // momentum change along y
+        double *dPdt_z = arenaAlloc(arena, size1); // momentum change along z
 
-        initialize(nn, LX, LY, LZ, myid,
-                   local_origin_x, local_origin_y, local_origin_z,
-                   rhoAvg, &ex[0], &ey[0], &ez[0], &wt[0], 
-                   rho, u, v, w, f, f_new, f_eq);
+        double *f      = arenaAlloc(arena, size2); // PDF
+        double *f_eq   = arenaAlloc(arena, size2); // PDF
+        double *f_new  = arenaAlloc(arena, size2); // PDF
+
+//      select the encoding for PDF halo messages
+
+        haloCodecSetup(pdf_codec, halo_codec_mode, halo_codec_tol);
+
+//      initialize fields, or continue from a checkpoint (read onto this process grid)
+
+        int time = 0;
+
+        if(restart_from_checkpoint)
+        {
+          time = checkpointRead(ckpt, checkpoint_file, nn, Q, LX, LY, LZ, NX, NY, NZ,
+                                x_range.beg, y_range.beg, z_range.beg,
+                                rho, f, f_eq, f_new, u, v, w, myid, CART_COMM);
+        }
+        else
+        {
+          initialize(nn, LX, LY, LZ, myid,
+                     local_origin_x, local_origin_y, local_origin_z,
+                     rhoAvg, initial_condition, &ex[0], &ey[0], &ez[0], &wt[0], 
+                     rho, u, v, w, f, f_new, f_eq);
+        }
 
         // fill ghost layers in the macroscopic variable buffers ( rho, u, v, w )
+        // (also after a restart: checkpoints only hold interior nodes)
 
         fillGhostLayersMacVar(nn,              // ghost layer thickness
                               LX,              // number of nodes along X (local for this MPI process)
@@ -101,7 +140,8 @@
                      nbr_NORTH,         // process id of my northern neighbor
                      nbr_BOTTOM,        // process id of my bottom neighbor
                      nbr_TOP,           // process id of my top neighbor
-                     f);                // pointer to the 4D array being exchanged (of type double)
+                     f,                 // pointer to the 4D array being exchanged (of type double)
+                     pdf_codec);        // encoding used for the halo messages
 
         exchangePDF (nn,                // number of ghost cell layers
                      Q,                 // number of LBM streaming directions
@@ -116,7 +156,8 @@
                      nbr_NORTH,         // process id of my northern neighbor
                      nbr_BOTTOM,        // process id of my bottom neighbor
                      nbr_TOP,           // process id of my top neighbor
-                     f_new);            // pointer to the 4D array being exchanged (of type double)
+                     f_new,             // pointer to the 4D array being exchanged (of type double)
+                     pdf_codec);        // encoding used for the halo messages
 
         exchangePDF (nn,                // number of ghost cell layers
                      Q,                 // number of LBM streaming directions
@@ -131,86 +172,370 @@
                      nbr_NORTH,         // process id of my northern neighbor
                      nbr_BOTTOM,        // process id of my bottom neighbor
                      nbr_TOP,           // process id of my top neighbor
-                     f_eq);             // pointer to the 4D array being exchanged (of type double)
+                     f_eq,              // pointer to the 4D array being exchanged (of type double)
+                     pdf_codec);        // encoding used for the halo messages
+
+//      persistent requests for the partitioned PDF exchange
+
+        if(use_partitioned_halo)
+        {
+          haloPlanSetup(pdf_plan, nn, Q, LX, LY, LZ, CART_COMM,
+                        nbr_WEST, nbr_EAST, nbr_SOUTH, nbr_NORTH, nbr_BOTTOM, nbr_TOP,
+                        thread_provided);
+        }
+
+//      over-decomposition: move the initial state into small blocks driven by the task scheduler
+
+        if(use_blocks)
+        {
+          if(checkpoint_interval > 0 && myid == 0)
+          {
+            std::cout << "WARNING: no checkpoints are written in block mode (a restart from one still works)" << std::endl;
+          }
+
+          schedulerStart(sched, block_threads);
+
+          blockGridSetup(grid, sched, nn, Q, LX, LY, LZ, block_size,
+                         ex, ey, ez, wt, G11, tau, skip_quiescent, quiescent_tol, block_order,
+                         CART_COMM, coords);
+
+          blockScatter(grid, rho, u, v, w, f, f_eq, f_new);
+
+          // the blocks own the solution now, only rho is kept at rank level (output, diagnostics)
+
+          arenaDiscard(arena, u,      size1); u = NULL;
+          arenaDiscard(arena, v,      size1); v = NULL;
+          arenaDiscard(arena, w,      size1); w = NULL;
+          arenaDiscard(arena, dPdt_x, size1); dPdt_x = NULL;
+          arenaDiscard(arena, dPdt_y, size1); dPdt_y = NULL;
+          arenaDiscard(arena, dPdt_z, size1); dPdt_z = NULL;
+          arenaDiscard(arena, f,      size2); f = NULL;
+          arenaDiscard(arena, f_eq,   size2); f_eq = NULL;
+          arenaDiscard(arena, f_new,  size2); f_new = NULL;
+        }
+
+//      low-memory mode: velocity and force only live inside collideFused, their fields are released
+
+        const bool low_memory = use_low_memory && !use_blocks;
+
+        if(low_memory)
+        {
+          arenaDiscard(arena, u,      size1); u = NULL;
+          arenaDiscard(arena, v,      size1); v = NULL;
+          arenaDiscard(arena, w,      size1); w = NULL;
+          arenaDiscard(arena, dPdt_x, size1); dPdt_x = NULL;
+          arenaDiscard(arena, dPdt_y, size1); dPdt_y = NULL;
+          arenaDiscard(arena, dPdt_z, size1); dPdt_z = NULL;
+        }
+
+//      equation of state behind psi(rho) (optionally tabulated)
+
+        eosSetup(eos, eos_model, GEE11, eos_T_ratio, eos_use_table, eos_table_size, eos_rho_max);
+        psiSetEOS(&eos);
+
+//      narrow band for the cohesive force (starts out covering the whole sub-domain)
+
+        if(use_narrow_band && !use_blocks && !low_memory)
+        {
+          narrowBandSetup(band, nn, LX, LY, LZ, narrow_band_width, narrow_band_tol);
+        }
+
+        // after a restart from a checkpoint without u, v, w the band cannot be scanned: the first step
+        // evaluates the force everywhere (the band still covers every node) and updateMacro fills them in
+        bool band_velocity = !restart_from_checkpoint || ckpt.restart_velocity;
+
+//      kernel variant: fixed by the settings above, or searched for during the first time steps
+//      (only between exact variants: not with the narrow band, and not in the low-memory mode, which has no u, v, w fields)
+
+        const bool autotune = use_autotune && !use_blocks && !low_memory && !use_narrow_band;
+
+        kernel_variant fallback = {low_memory ? COLLIDE_FUSED : (use_psi_window ? COLLIDE_WINDOW : COLLIDE_UNFUSED),
+                                   nt_stores};
+
+        autotuneSetup(tuner, autotune, autotune_steps, fallback, autotune_cache, LX, LY, LZ, myid, CART_COMM);
+
+        // the fused variant has no use for u, v, w and dPdt (released once it is chosen, from the cache or by the search)
+
+        auto releaseVelocityFields = [&]()
+        {
+          arenaDiscard(arena, u,      size1); u = NULL;
+          arenaDiscard(arena, v,      size1); v = NULL;
+          arenaDiscard(arena, w,      size1); w = NULL;
+          arenaDiscard(arena, dPdt_x, size1); dPdt_x = NULL;
+          arenaDiscard(arena, dPdt_y, size1); dPdt_y = NULL;
+          arenaDiscard(arena, dPdt_z, size1); dPdt_z = NULL;
+        };
+
+        if(tuner.cached && tuner.best.collide == COLLIDE_FUSED) releaseVelocityFields();
+
+        int stores_mode = nt_stores;   // streaming-store mode in effect
+
+//      start the communication thread (halo exchanges inside the time loop are posted to it)
+
+        commThreadStart(comm, use_comm_thread, thread_provided, myid);
 
 //      time integration
 
-        int time = 0;
         clock_t t0, tN;
         t0 = clock();
 
-//      write initial condition to output files
+//      reference mass for the conservation diagnostic
+
+        const double mass_initial = totalMass(nn, LX, LY, LZ, rho, CART_COMM);
+
+//      storage of the output datasets (chunking, compression, quantization)
+
+        outputCodecSetup(out_codec, output_filter, output_deflate_level, output_quantize_tol, output_benchmark);
+
+//      global XDMF time series: rank 0 adds every frame once its files are complete on all ranks
+
+        timeSeriesSetup(series, write_time_series, time_series_file,
+                        io.enabled ? SERIES_IO : (output_mode == OUTPUT_SHARED && output_filter == OUTPUT_FILTER_NONE ? SERIES_SHARED
+                                               : (output_mode == OUTPUT_SERIES ? SERIES_APPEND : SERIES_PER_RANK)),
+                        io.server_id, x_range.beg, y_range.beg, z_range.beg, LX, LY, LZ, NX, NY, NZ,
+                        local_origin_x, local_origin_y, local_origin_z, delta,
+                        restart_from_checkpoint ? time : -1, myid, CART_COMM);
 
-        writeMesh(nn, CART_COMM, myid, 
-                  local_origin_x, local_origin_y, local_origin_z, delta, 
-                  LX, LY, LZ, time, rho);
+//      one frame of output: interior rho of every rank (from "field", a copy of rho)
 
-//      time integration loop
+        auto writeFrame = [&](const int t, const double* field, const MPI_Comm frame_comm)
+        {
+          if(output_mode == OUTPUT_SHARED)
+          {
+            writeMeshShared(nn, frame_comm, myid,
+                            local_origin_x, local_origin_y, local_origin_z, delta,
+                            NX, NY, NZ, x_range.beg, y_range.beg, z_range.beg,
+                            LX, LY, LZ, t, field, out_codec);
+          }
+          else if(output_mode == OUTPUT_SERIES)
+          {
+            writeMeshSeries(out_series, nn, myid, x_range.beg, y_range.beg, z_range.beg,
+                            LX, LY, LZ, t, field, out_codec);
+          }
+          else
+          {
+            writeMesh(nn, frame_comm, myid, 
+                      local_origin_x, local_origin_y, local_origin_z, delta, 
+                      x_range.beg, y_range.beg, z_range.beg,
+                      LX, LY, LZ, t, field, out_codec);
+          }
+        };
+
+//      start the output thread (frames are written in the background while the solver steps on)
+
+        outputThreadStart(output, use_async_output, output_mode == OUTPUT_SHARED, thread_provided,
+                          nn, LX, LY, LZ, writeFrame, myid, CART_COMM);
+
+//      frames go to the I/O server of this rank, or to the (possibly asynchronous) writer;
+//      the time series lists those that are complete on all ranks so far
+
+        auto framesWritten = [&]()
+        {
+          return io.enabled ? ioClientWritten(io) : outputThreadWritten(output);
+        };
+
+        auto outputFrame = [&](const int t)
+        {
+          if(io.enabled)
+          {
+            ioClientSend(io, t, rho, strideX(nn, LX), strideY(nn, LX, LY), nn,
+                         x_range.beg, y_range.beg, z_range.beg, LX, LY, LZ);
+          }
+          else
+          {
+            outputThreadWrite(output, t, rho);
+          }
+
+          timeSeriesPost(series, t);
+          timeSeriesConfirm(series, framesWritten(), CART_COMM);
+        };
+
+//      write initial condition to output files (a restart continues the frames of the earlier run)
+
+        if(!restart_from_checkpoint) outputFrame(time);
+
+//      time integration loop (workspace buffers are sized during the first step)
+
+        long long allocations_step1 = 0;
+        const int time_begin = time;
 
         while(time < MAXIMUM_TIME)
         {
           time++; // increment lattice time
 
-          streaming(nn, LX, LY, LZ, ex, ey, ez, tau, f, f_new, f_eq);
-
-          calc_dPdt(nn, LX, LY, LZ, ex, ey, ez, G11, rho, dPdt_x, dPdt_y, dPdt_z);
-
-          updateMacro(nn, LX, LY, LZ, ex, ey, ez, wt, tau, 
-                      rho, u, v, w, dPdt_x, dPdt_y, dPdt_z, f);
-
-          // fill ghost layers in the macroscopic variable buffers ( rho, u, v, w )
-
-          fillGhostLayersMacVar(nn,              // ghost layer thickness
-                                LX,              // number of nodes along X (local for this MPI process)
-                                LY,              // number of nodes along Y (local for this MPI process)
-                                LZ,              // number of nodes along Z (local for this MPI process)
-                                myid,            // MPI process id or rank
-                                CART_COMM,       // Cartesian communicator
-                                nbr_WEST,        // neighboring MPI process to my west
-                                nbr_EAST,        // neighboring MPI process to my east
-                                nbr_SOUTH,       // neighboring MPI process to my south
-                                nbr_NORTH,       // neighboring MPI process to my north
-                                nbr_BOTTOM,      // neighboring MPI process to my bottom
-                                nbr_TOP,         // neighboring MPI process to my top
-                                rho,            // density
-                                u,              // velocity (x-component)
-                                v,              // velocity (y-component)
-                                w);             // velocity (z-component)
-
-          updateEquilibrium(nn, LX, LY, LZ, ex, ey, ez, wt, rho, u, v, w, f_eq);
-
-          exchangePDF (nn,                // number of ghost cell layers
-                       Q,                 // number of LBM streaming directions
-                       LX,                // number of voxels along X in this process
-                       LY,                // number of voxels along Y in this process
-                       LZ,                // number of voxels along Z in this process
-                       myid,              // my process id
-                       CART_COMM,         // Cartesian topology communicator
-                       nbr_WEST,          // process id of my western neighbor
-                       nbr_EAST,          // process id of my eastern neighbor
-                       nbr_SOUTH,         // process id of my southern neighbor
-                       nbr_NORTH,         // process id of my northern neighbor
-                       nbr_BOTTOM,        // process id of my bottom neighbor
-                       nbr_TOP,           // process id of my top neighbor
-                       f_eq);             // pointer to the 4D array being exchanged (of type double)
-
-//        transfer fnew back to f
-
-          const int GX = nn + LX + nn;  // size along X including ghost nodes
-          const int GY = nn + LY + nn;  // size along Y including ghost nodes
-          const int GZ = nn + LZ + nn;  // size along Z including ghost nodes
-          for(int f_index = 0; f_index < GX*GY*GZ*19; f_index++)
+          if(use_blocks)
+          {
+            blockStep(grid, sched);
+          }
+          else
           {
-            f[f_index] = f_new[f_index];
+            double t_step = MPI_Wtime();
+
+            kernel_variant variant = autotuneVariant(tuner);
+            if(variant.stores != stores_mode)
+            {
+              stores_mode = variant.stores;
+              storeMode(stores_mode);
+            }
+
+            // ghost layers of f_eq and rho must be current before streaming and calc_dPdt
+
+            commThreadWait(comm);
+
+            streaming(nn, LX, LY, LZ, ex, ey, ez, tau, f, f_new, f_eq);
+
+            if(variant.collide == COLLIDE_FUSED)
+            {
+              // force, rho and f_eq in one pass; only rho needs its ghost layers refreshed
+
+              collideFused(nn, LX, LY, LZ, ex, ey, ez, wt, G11, tau, rho, f, f_eq);
+
+              commThreadPost(comm, [&]()
+              {
+                exchangeDBL(nn, LX, LY, LZ, myid, CART_COMM,
+                            nbr_WEST, nbr_EAST, nbr_SOUTH, nbr_NORTH, nbr_BOTTOM, nbr_TOP, rho);
+              });
+            }
+            else
+            {
+              if(use_narrow_band && band_velocity)
+              {
+                calc_dPdtBand(band, nn, LX, LY, LZ, ex, ey, ez, G11, rho, u, v, w, dPdt_x, dPdt_y, dPdt_z);
+
+                // compare with the full stencil whenever output is written
+                if(time%frame_rate == 0)
+                {
+                  narrowBandCheck(band, nn, LX, LY, LZ, ex, ey, ez, G11, rho, dPdt_x, dPdt_y, dPdt_z);
+                }
+              }
+              else if(variant.collide == COLLIDE_WINDOW)
+              {
+                calc_dPdtWindow(nn, LX, LY, LZ, ex, ey, ez, G11, rho, dPdt_x, dPdt_y, dPdt_z);
+              }
+              else
+              {
+                calc_dPdt(nn, LX, LY, LZ, ex, ey, ez, G11, rho, dPdt_x, dPdt_y, dPdt_z);
+              }
+
+              updateMacro(nn, LX, LY, LZ, ex, ey, ez, wt, tau, 
+                          rho, u, v, w, dPdt_x, dPdt_y, dPdt_z, f);
+              band_velocity = true;
+
+              // fill ghost layers in the macroscopic variable buffers ( rho, u, v, w )
+              // (overlaps with updateEquilibrium, which only reads interior nodes)
+
+              commThreadPost(comm, [&]()
+              {
+                fillGhostLayersMacVar(nn,              // ghost layer thickness
+                                      LX,              // number of nodes along X (local for this MPI process)
+                                      LY,              // number of nodes along Y (local for this MPI process)
+                                      LZ,              // number of nodes along Z (local for this MPI process)
+                                      myid,            // MPI process id or rank
+                                      CART_COMM,       // Cartesian communicator
+                                      nbr_WEST,        // neighboring MPI process to my west
+                                      nbr_EAST,        // neighboring MPI process to my east
+                                      nbr_SOUTH,       // neighboring MPI process to my south
+                                      nbr_NORTH,       // neighboring MPI process to my north
+                                      nbr_BOTTOM,      // neighboring MPI process to my bottom
+                                      nbr_TOP,         // neighboring MPI process to my top
+                                      rho,            // density
+                                      u,              // velocity (x-component)
+                                      v,              // velocity (y-component)
+                                      w);             // velocity (z-component)
+              });
+
+              updateEquilibrium(nn, LX, LY, LZ, ex, ey, ez, wt, rho, u, v, w, f_eq);
+            }
+
+            // f_eq is ready --> exchange it while f_new is copied back to f
+
+            commThreadPost(comm, [&]()
+            {
+              if(use_partitioned_halo)
+              {
+                exchangePDFPartitioned(pdf_plan, f_eq, pdf_codec);
+              }
+              else
+              {
+                exchangePDF (nn,                // number of ghost cell layers
+                             Q,                 // number of LBM streaming directions
+                             LX,                // number of voxels along X in this process
+                             LY,                // number of voxels along Y in this process
+                             LZ,                // number of voxels along Z in this process
+                             myid,              // my process id
+                             CART_COMM,         // Cartesian topology communicator
+                             nbr_WEST,          // process id of my western neighbor
+                             nbr_EAST,          // process id of my eastern neighbor
+                             nbr_SOUTH,         // process id of my southern neighbor
+                             nbr_NORTH,         // process id of my northern neighbor
+                             nbr_BOTTOM,        // process id of my bottom neighbor
+                             nbr_TOP,           // process id of my top neighbor
+                             f_eq,              // pointer to the 4D array being exchanged (of type double)
+                             pdf_codec);        // encoding used for the halo messages
+              }
+            });
+
+//          transfer fnew back to f
+
+            std::chrono::steady_clock::time_point t_copy = std::chrono::steady_clock::now();
+            const bool copy_streamed = streamingStores(size2 * (long long) sizeof(double));
+            if(copy_streamed)
+            {
+              streamStore(f, f_new, size2);
+              storeFence();
+            }
+            else
+            {
+              for(long long f_index = 0; f_index < size2; f_index++)
+              {
+                f[f_index] = f_new[f_index];
+              }
+            }
+            trafficAdd(TRAFFIC_COPY, t_copy, size2 * (long long) sizeof(double),
+                       size2 * (long long) sizeof(double), copy_streamed);
+
+            // score the variant used for this step; the fused winner no longer needs u, v, w and dPdt
+
+            if(tuner.active)
+            {
+              // the reduction inside must not overlap the f_eq exchange on the communication thread
+              const double seconds = MPI_Wtime() - t_step;
+              commThreadWait(comm);
+              autotuneRecord(tuner, seconds, autotune_cache, myid, CART_COMM);
+
+              if(!tuner.active && tuner.best.collide == COLLIDE_FUSED)
+              {
+                commThreadWait(comm);   // the last unfused step may still be exchanging u, v and w
+                releaseVelocityFields();
+              }
+            }
           }
 
 //        write output data using (XDMF+HDF5)
 
           if(time%frame_rate == 0) 
           {
-             writeMesh(nn, CART_COMM, myid, 
-                       local_origin_x, local_origin_y, local_origin_z, delta, 
-                       LX, LY, LZ, time, rho);
+             if(use_blocks)
+             {
+               // density is only kept at rank level for output
+               blockGather(grid, rho);
+             }
+
+             // only interior nodes are written (and copied for the output thread):
+             // a rho exchange still in flight does not matter
+
+             outputFrame(time);
+          }
+
+//        write the full solver state (rank mode: in block mode the blocks own the PDFs)
+
+          if(checkpoint_interval > 0 && time%checkpoint_interval == 0 && !use_blocks)
+          {
+            commThreadWait(comm);   // ghost layers of f_eq and rho must be complete
+
+            checkpointWrite(ckpt, checkpoint_file, time, nn, Q, LX, LY, LZ, NX, NY, NZ,
+                            x_range.beg, y_range.beg, z_range.beg, dims,
+                            rho, f, f_eq, u, v, w, myid, CART_COMM);
           }
 
 //        calculate the number of lattice time-steps per second
@@ -220,20 +545,74 @@
 //        std::cout << " lattice time steps per second = " 
 //                  << (float) CLOCKS_PER_SEC * time / (float) tN 
 //                  << std::endl;
+
+          if(time == time_begin + 1)
+          {
+            commThreadWait(comm);
+            allocations_step1 = workspaceAllocations();
+          }
+        }
+
+//      all halo traffic is finished before the communication thread exits
+
+        commThreadWait(comm);
+        commThreadStop(comm);
+
+        commThreadReport(comm, use_comm_thread, myid, CART_COMM);
+
+//      write the frames still queued (then list them in the time series) and report how much output time was hidden
+
+        outputThreadStop(output);
+        writeMeshSeriesClose(out_series);
+        if(io.enabled) ioClientFinish(io);
+        timeSeriesConfirm(series, framesWritten(), CART_COMM);
+        if(io.enabled)
+        {
+          ioServerReport(io, myid, CART_COMM);
+        }
+        else
+        {
+          outputThreadReport(output, use_async_output, myid, CART_COMM);
+          outputCodecReport(out_codec, myid, CART_COMM);
         }
 
+        checkpointReport(ckpt, use_blocks ? 0 : checkpoint_interval, dims, myid, CART_COMM);
+
+        if(use_partitioned_halo) haloPlanFree(pdf_plan);
+
+        if(use_blocks)
+        {
+          schedulerStop(sched);
+          schedulerReport(sched, myid);
+          blockReport(grid, myid);
+          blockGather(grid, rho);
+          blockGridFree(grid);
+        }
+
+        eosReport(eos, myid);
+
+        autotuneReport(tuner, autotune, myid);
+
+        if(use_narrow_band && !use_blocks && !low_memory) narrowBandReport(band, myid, CART_COMM);
+
+//      report halo exchange cost and mass conservation
+
+        haloCodecReport(pdf_codec, mass_initial, totalMass(nn, LX, LY, LZ, rho, CART_COMM),
+                        myid, CART_COMM);
+
+//      report how the fields were allocated
+
+        arenaReport(arena, workspaceAllocations() - allocations_step1, myid, CART_COMM);
+        strideReport(nn, LX, LY, myid);
+
+//      report memory bandwidth of the streaming, equilibrium and copy kernels
+
+        trafficReport(myid, CART_COMM);
+
 //      clean up
 
-        delete[] rho;
-        delete[] u;
-        delete[] v;
-        delete[] w;
-        delete[] dPdt_x;
-        delete[] dPdt_y;
-        delete[] dPdt_z;
-        delete[] f;
-        delete[] f_eq;
-        delete[] f_new;
+        arenaRelease(arena);
+        workspaceRelease();
 
 //      MPI clean up
 
@@ -8,6 +8,21 @@
       #include <ctime>        // clock_t, clock(), CLOCKS_PER_SEC
       #include <mpi.h>        // MPI 
 
+      #include "exchangeInfo.h" // pdf_halo_plan, halo_codec, HALO_CODEC_*
+      #include "commThread.h" // comm_thread
+      #include "blockGrid.h"  // block_grid, task_scheduler, BRICK_ORDER_*
+      #include "narrowBand.h" // narrow_band
+      #include "equationOfState.h" // eos_table, EOS_*
+      #include "latticeArena.h" // lattice_arena, ARENA_PAGES_*
+      #include "nonTemporal.h" // NT_STORES_*, TRAFFIC_*
+      #include "autotune.h"   // autotuner, kernel_variant, COLLIDE_*
+      #include "writeMesh.h"  // OUTPUT_*
+      #include "asyncOutput.h" // output_thread, frame_writer
+      #include "ioServer.h"   // io_server
+      #include "initialize.h" // INIT_*
+      #include "checkpoint.h" // checkpoint_stats
+      #include "timeSeries.h" // xdmf_series
+
 //    data structures
 
 //    define a struct to store the beginning and ending node numbers inside a process
@@ -32,7 +47,11 @@
                             int* nbr_SOUTH,         // pointer to --> ID of neighboring process to my south  (i,j-1,k)
                             int* nbr_NORTH,         // pointer to --> ID of neighboring process to my north  (i,j+1,k)
                             int* nbr_BOTTOM,        // pointer to --> ID of neighboring process to my bottom (i,j,k-1)
-                            int* nbr_TOP);          // pointer to --> ID of neighboring process to my top    (i,j,k+1)
+                            int* nbr_TOP,           // pointer to --> ID of neighboring process to my top    (i,j,k+1)
+                            const int thread_required,  // level of thread support requested from MPI (MPI_THREAD_SINGLE, ..., MPI_THREAD_MULTIPLE)
+                            int* thread_provided,   // pointer to --> level of thread support provided by the MPI library
+                            const int io_ratio,     // world ranks per I/O server (0 = no I/O servers)
+                            io_server & io);        // I/O server split (I/O server ranks return without a CART_COMM)
 
 void domainDecomp3D(// inputs
                     const int      & myid,           // MPI rank
@@ -64,6 +83,7 @@ void domainDecomp3D(// inputs
                              const double local_origin_y,
                              const double local_origin_z,
                              const double rhoAvg,
+                             const int init_case,      // INIT_CYLINDER or INIT_SPINODAL
                              double* ex, double* ey, double* ez, double* wt,
                              double* rho, double* u, double* v, double* w,
                              double* f, double* f_new, double* f_eq);
@@ -74,12 +94,122 @@ void domainDecomp3D(// inputs
                             double* ex, double* ey, double* ez, double tau,
                             double* f, double* f_new, double* f_eq);
 
+//    aligned slab for all lattice fields and the workspace pool (see latticeArena.cpp)
+
+      extern void arenaCreate(lattice_arena & arena,
+                              const size_t    bytes,       // total size of all fields (including alignment padding)
+                              const int       pages,       // ARENA_PAGES_*
+                              const int       numa_node);  // bind the slab to this NUMA node (-1: no binding)
+
+      extern double* arenaAlloc(lattice_arena & arena, const long long count);
+
+      extern void arenaDiscard(lattice_arena & arena, double * field, const long long count);
+
+      extern void arenaRelease(lattice_arena & arena);
+
+      extern void arenaReport(const lattice_arena & arena, const long long loop_allocations,
+                              const int myid, const MPI_Comm CART_COMM);
+
+      extern void workspaceSetup(const int pages);
+
+      extern long long workspaceAllocations();
+
+      extern void workspaceRelease();
+
+      extern void strideSetup(const bool pad,              // pad row and plane strides
+                              const int Q,                 // number of PDFs per node
+                              const MPI_Comm CART_COMM);   // all ranks use the cache geometry of rank 0
+
+      extern void strideReport(const int nn, const int LX, const int LY, const int myid);
+
+//    streaming stores for write-only outputs and per-kernel memory traffic (see nonTemporal.cpp)
+
+      extern void storeSetup(const int mode,        // NT_STORES_*
+                             const int distance);   // software prefetch distance in nodes (0 = off)
+
+      extern void storeMode(const int mode);        // NT_STORES_* (keeps the cache size and traffic counters)
+
+      extern void trafficReport(const int myid, const MPI_Comm CART_COMM);
+
+//    startup search for the fastest rank-mode kernel variant (see autotune.cpp)
+
+      extern void autotuneSetup(autotuner & tuner,
+                                const bool  enabled,               // search, or always use the fallback variant
+                                const int   steps,                 // time steps per candidate
+                                const kernel_variant & fallback,   // variant used without a search
+                                const char* cache_file,            // file holding earlier choices
+                                const int   LX,                    // local nodes along X
+                                const int   LY,                    // local nodes along Y
+                                const int   LZ,                    // local nodes along Z
+                                const int   myid,                  // MPI rank
+                                const MPI_Comm CART_COMM);         // all ranks use the choice of rank 0
+
+      extern kernel_variant autotuneVariant(const autotuner & tuner);
+
+      extern void autotuneRecord(autotuner & tuner,
+                                 const double seconds,             // duration of the last step on this rank
+                                 const char* cache_file,
+                                 const int myid,
+                                 const MPI_Comm CART_COMM);
+
+      extern void autotuneReport(const autotuner & tuner, const bool enabled, const int myid);
+
+//    equation of state behind the pseudopotential psi(rho) (see equationOfState.cpp)
+
+      extern void eosSetup(eos_table  & eos,
+                           const int    model,        // one of EOS_*
+                           const double G,            // interaction strength (GEE11)
+                           const double T_ratio,      // temperature as a fraction of the critical temperature
+                           const bool   use_table,    // interpolate psi from a table
+                           const int    table_size,   // number of table entries
+                           const double rho_max);     // largest density covered by the table
+
+      extern void eosReport(const eos_table & eos, const int myid);
+
+      extern void psiSetEOS(const eos_table *eos);
+
 //    calculate the change in momentum because of inter-particle forces
 
       extern void calc_dPdt(const int nn, const int NX, const int NY, const double NZ,
                             double* ex, double* ey, double* ez, double* G11,
                             double* rho, double* dPdt_x, double* dPdt_y, double* dPdt_z);
 
+//    same force, with psi computed once per node and reused from a sliding window
+
+      extern void calc_dPdtWindow(const int nn, const int NX, const int NY, const int NZ,
+                                  double* ex, double* ey, double* ez, double* G11,
+                                  double* rho, double* dPdt_x, double* dPdt_y, double* dPdt_z);
+
+//    force, density, velocity and f_eq in one pass without storing u, v, w or dPdt (low-memory mode)
+
+      extern void collideFused(const int nn, const int NX, const int NY, const int NZ,
+                               double* ex, double* ey, double* ez, double* wt, double* G11,
+                               double tau,
+                               double* rho, double* f, double* f_eq);
+
+//    same force, evaluated only in a narrow band around the interfaces (see narrowBand.cpp)
+
+      extern void narrowBandSetup(narrow_band & band,
+                                  const int     nn,       // ghost layer thickness
+                                  const int     NX,       // local nodes along X
+                                  const int     NY,       // local nodes along Y
+                                  const int     NZ,       // local nodes along Z
+                                  const int     width,    // lattice units kept around the interface
+                                  const double  tol);     // uniformity tolerance
+
+      extern void calc_dPdtBand(narrow_band & band,
+                                const int nn, const int NX, const int NY, const int NZ,
+                                double* ex, double* ey, double* ez, double* G11,
+                                double* rho, double* u, double* v, double* w,
+                                double* dPdt_x, double* dPdt_y, double* dPdt_z);
+
+      extern void narrowBandCheck(narrow_band & band,
+                                  const int nn, const int NX, const int NY, const int NZ,
+                                  double* ex, double* ey, double* ez, double* G11,
+                                  double* rho, const double* dPdt_x, const double* dPdt_y, const double* dPdt_z);
+
+      extern void narrowBandReport(const narrow_band & band, const int myid, const MPI_Comm CART_COMM);
+
 //    calculate the density and velocity at all nodes
 
       extern void updateMacro(const int nn, const int NX, const int NY, const int NZ,
@@ -121,7 +251,263 @@ void domainDecomp3D(// inputs
                                const int      nbr_NORTH,         // process id of my northern neighbor
                                const int      nbr_BOTTOM,        // process id of my bottom neighbor
                                const int      nbr_TOP,           // process id of my top neighbor
-                                  double      *PDF4d);            // pointer to the 4D array being exchanged (of type double)
+                                  double      *PDF4d,             // pointer to the 4D array being exchanged (of type double)
+                               halo_codec     &codec);            // encoding used for the halo messages (and exchange statistics)
+
+//    partitioned PDF halo exchange (thread-parallel packing, one partition per PDF direction)
+
+      extern void haloPlanSetup(pdf_halo_plan  & plan,
+                                const int        nn,                // number of ghost cell layers
+                                const int        Q,                 // number of LBM streaming directions
+                                const int        MX,                // number of voxels along X in this process
+                                const int        MY,                // number of voxels along Y in this process
+                                const int        MZ,                // number of voxels along Z in this process
+                                const MPI_Comm   CART_COMM,         // Cartesian topology communicator
+                                const int        nbr_WEST,          // process id of my western neighbor
+                                const int        nbr_EAST,          // process id of my eastern neighbor
+                                const int        nbr_SOUTH,         // process id of my southern neighbor
+                                const int        nbr_NORTH,         // process id of my northern neighbor
+                                const int        nbr_BOTTOM,        // process id of my bottom neighbor
+                                const int        nbr_TOP,           // process id of my top neighbor
+                                const int        thread_provided);  // thread support level returned by MPI_Init_thread
+
+      extern void exchangePDFPartitioned(pdf_halo_plan & plan,
+                                         double        * PDF4d,     // pointer to the 4D array being exchanged (of type double)
+                                         halo_codec    & codec);    // only the exchange time is recorded here
+
+      extern void haloPlanFree(pdf_halo_plan & plan);
+
+//    exchange ghost layers of a scalar field (see exchangeDBL.cpp)
+
+      extern void exchangeDBL  (const int      & nn,                // number of ghost cell layers
+                                const int      & MX,                // number of voxels along X in this process
+                                const int      & MY,                // number of voxels along Y in this process
+                                const int      & MZ,                // number of voxels along Z in this process
+                                const int      & myid,              // my process id
+                                const MPI_Comm & CART_COMM,         // Cartesian topology communicator
+                                const int      & nbr_WEST,          // process id of my western neighbor
+                                const int      & nbr_EAST,          // process id of my eastern neighbor
+                                const int      & nbr_SOUTH,         // process id of my southern neighbor
+                                const int      & nbr_NORTH,         // process id of my northern neighbor
+                                const int      & nbr_BOTTOM,        // process id of my bottom neighbor
+                                const int      & nbr_TOP,           // process id of my top neighbor
+                                   double      * color);            // pointer to the 3D array being exchanged
+
+//    reduced-precision PDF halo messages and mass conservation diagnostics
+
+      extern void haloCodecSetup(halo_codec & codec, const int mode, const double tol);
+
+      extern double totalMass(const int nn, const int LX, const int LY, const int LZ,
+                              const double* rho, const MPI_Comm CART_COMM);
+
+      extern void haloCodecReport(const halo_codec & codec,
+                                  const double       mass_initial,
+                                  const double       mass_final,
+                                  const int          myid,
+                                  const MPI_Comm     CART_COMM);
+
+//    dedicated thread for halo exchanges
+
+      extern void commThreadStart(comm_thread & comm,
+                                  const bool    enable,            // user wants a communication thread
+                                  const int     thread_provided,   // thread support level returned by MPI_Init_thread
+                                  const int     myid);             // MPI rank
+
+      extern void commThreadPost(comm_thread & comm, const std::function<void()> & job);
+
+      extern void commThreadWait(comm_thread & comm);
+
+      extern void commThreadStop(comm_thread & comm);
+
+      extern void commThreadReport(const comm_thread & comm,
+                                   const bool          enable,
+                                   const int           myid,
+                                   const MPI_Comm      CART_COMM);
+
+//    dedicated I/O server ranks (see ioServer.cpp)
+
+      extern void ioServerRun(io_server & io, const double delta, output_codec & codec);
+
+      extern void ioClientSend(io_server & io,
+                               const int   time,
+                               const double* field,          // rho with ghost layers (and padding)
+                               const long long SX,           // row stride of field
+                               const long long SY,           // rows per plane of field
+                               const int   nn,               // ghost layer thickness
+                               const int   offset_x,         // global index of the first local node along X
+                               const int   offset_y,         // global index of the first local node along Y
+                               const int   offset_z,         // global index of the first local node along Z
+                               const int   LX,               // local nodes along X
+                               const int   LY,               // local nodes along Y
+                               const int   LZ);              // local nodes along Z
+
+      extern int ioClientWritten(io_server & io);
+
+      extern void ioClientFinish(io_server & io);
+
+      extern void ioServerReport(const io_server & io, const int myid, const MPI_Comm CART_COMM);
+
+//    storage of the output datasets (see outputCodec.cpp)
+
+      extern void outputCodecSetup(output_codec & codec,
+                                   const int      filter,      // OUTPUT_FILTER_*
+                                   const int      level,       // deflate level
+                                   const double   tol,         // quantization error bound (0: lossless)
+                                   const bool     benchmark);  // time every benchmark setting on each frame
+
+      extern void outputCodecReport(const output_codec & codec, const int myid, const MPI_Comm comm);
+
+//    global XDMF time series, extended with every frame once it is complete (see timeSeries.cpp)
+
+      extern void timeSeriesSetup(xdmf_series &  series,
+                                  const bool     enable,
+                                  const char*    file_name,
+                                  const int      layout,          // SERIES_PER_RANK, _SHARED or _IO
+                                  const int      server_id,       // I/O server of this rank (SERIES_IO)
+                                  const int      x_beg,           // global index of the first local node along X
+                                  const int      y_beg,           // ... along Y
+                                  const int      z_beg,           // ... along Z
+                                  const int      LX,              // local nodes along X
+                                  const int      LY,              // local nodes along Y
+                                  const int      LZ,              // local nodes along Z
+                                  const int      NX,              // global nodes along X
+                                  const int      NY,              // global nodes along Y
+                                  const int      NZ,              // global nodes along Z
+                                  const double   local_origin_x,  // coordinates of the first local node
+                                  const double   local_origin_y,
+                                  const double   local_origin_z,
+                                  const double   delta,           // grid spacing
+                                  const int      restart_time,    // keep the frames up to this time (-1: new file)
+                                  const int      myid,
+                                  const MPI_Comm CART_COMM);
+
+      extern void timeSeriesPost(xdmf_series & series, const int time);
+
+      extern void timeSeriesConfirm(xdmf_series & series,
+                                    const int      written,         // time of the last frame this rank's writer finished (-1: none)
+                                    const MPI_Comm CART_COMM);
+
+//    checkpoint and restart of the full solver state (see checkpoint.cpp)
+
+      extern void checkpointWrite(checkpoint_stats & ckpt,
+                                  const char*      file_name,
+                                  const int        time,      // lattice time after the last completed step
+                                  const int        nn,        // ghost layer thickness
+                                  const int        Q,         // number of LBM streaming directions
+                                  const int        LX,        // local nodes along X
+                                  const int        LY,        // local nodes along Y
+                                  const int        LZ,        // local nodes along Z
+                                  const int        NX,        // global nodes along X
+                                  const int        NY,        // global nodes along Y
+                                  const int        NZ,        // global nodes along Z
+                                  const int        x_beg,     // global index of the first local node along X
+                                  const int        y_beg,     // ... along Y
+                                  const int        z_beg,     // ... along Z
+                                  const int*       dims,      // process grid (recorded in the file)
+                                  const double*    rho,
+                                  const double*    f,
+                                  const double*    f_eq,
+                                  const double*    u,         // velocity (NULL without velocity fields)
+                                  const double*    v,
+                                  const double*    w,
+                                  const int        myid,
+                                  const MPI_Comm   CART_COMM);
+
+      extern int checkpointRead(checkpoint_stats & ckpt,
+                                const char*      file_name,
+                                const int        nn,
+                                const int        Q,
+                                const int        LX,
+                                const int        LY,
+                                const int        LZ,
+                                const int        NX,
+                                const int        NY,
+                                const int        NZ,
+                                const int        x_beg,
+                                const int        y_beg,
+                                const int        z_beg,
+                                double*          rho,
+                                double*          f,
+                                double*          f_eq,
+                                double*          f_new,
+                                double*          u,
+                                double*          v,
+                                double*          w,
+                                const int        myid,
+                                const MPI_Comm   CART_COMM);
+
+      extern void checkpointReport(const checkpoint_stats & ckpt,
+                                   const int                interval,   // steps between checkpoints (0 = off)
+                                   const int*               dims,       // process grid of this run
+                                   const int                myid,
+                                   const MPI_Comm           CART_COMM);
+
+//    background thread writing snapshot frames (see asyncOutput.cpp)
+
+      extern void outputThreadStart(output_thread & out,
+                                    const bool      enable,            // user wants asynchronous output
+                                    const bool      writer_uses_mpi,   // frames are written with collective MPI-IO
+                                    const int       thread_provided,   // thread support level returned by MPI_Init_thread
+                                    const int       nn,                // ghost layers of the field
+                                    const int       LX,                // interior nodes of the field along X
+                                    const int       LY,                // interior nodes of the field along Y
+                                    const int       LZ,                // interior nodes of the field along Z
+                                    const frame_writer & writer,       // writes one frame from a copy of the field
+                                    const int       myid,              // MPI rank
+                                    const MPI_Comm  CART_COMM);        // duplicated for a writer that runs collectives
+
+      extern void outputThreadWrite(output_thread & out, const int time, const double* field);
+
+      extern int outputThreadWritten(output_thread & out);
+
+      extern void outputThreadStop(output_thread & out);
+
+      extern void outputThreadReport(const output_thread & out,
+                                     const bool            enable,
+                                     const int             myid,
+                                     const MPI_Comm        CART_COMM);
+
+//    work-stealing task scheduler
+
+      extern void schedulerStart(task_scheduler & sched, const int num_threads);
+
+      extern void schedulerStop(task_scheduler & sched);
+
+      extern void schedulerReport(const task_scheduler & sched, const int myid);
+
+//    over-decomposition of the local sub-domain into small blocks
+
+      extern void blockGridSetup(block_grid     & grid,
+                                 task_scheduler & sched,
+                                 const int        nn,            // ghost layer thickness (must be 1)
+                                 const int        Q,             // number of LBM streaming directions
+                                 const int        LX,            // local nodes along X
+                                 const int        LY,            // local nodes along Y
+                                 const int        LZ,            // local nodes along Z
+                                 const int        block_size,    // target number of nodes along each edge of a block
+                                 double         * ex,            // D3Q19 directions
+                                 double         * ey,
+                                 double         * ez,
+                                 double         * wt,            // weight factors
+                                 double         * G11,           // cohesive force along the lattice directions
+                                 const double     tau,           // relaxation time
+                                 const bool       skip_quiescent,// skip the update of blocks that have reached a uniform state
+                                 const double     quiescent_tol, // max. deviation from the uniform state
+                                 const int        block_order,   // BRICK_ORDER_* (storage and scheduling order of the blocks)
+                                 const MPI_Comm   CART_COMM,     // Cartesian communicator
+                                 const int      * coords);       // coordinates of this rank in the Cartesian topology
+
+      extern void blockScatter(block_grid & grid,
+                               const double* rho, const double* u, const double* v, const double* w,
+                               const double* f, const double* f_eq, const double* f_new);
+
+      extern void blockGather(const block_grid & grid, double* rho);
+
+      extern void blockStep(block_grid & grid, task_scheduler & sched);
+
+      extern void blockReport(const block_grid & grid, const int myid);
+
+      extern void blockGridFree(block_grid & grid);
 
 //    update equilibrium PDFs based on the latest {rho,u,v,w}
 
@@ -133,18 +519,42 @@ void domainDecomp3D(// inputs
 
 //    writes data to output files using XDMF + HDF5 format
 
-      extern void writeMesh(const int      nn,
-                            const MPI_Comm CART_COMM, 
-                            const int      myid, 
-                            const double   local_origin_x, 
-                            const double   local_origin_y, 
-                            const double   local_origin_z, 
-                            const double   delta, 
-                            const int      NX, 
-                            const int      NY, 
-                            const int      NZ, 
-                            const int      time,
-                            const double*  rho);
+      // writeMesh (one file per rank and frame) is declared in writeMesh.h
+
+      extern void writeMeshShared(const int      nn,
+                                  const MPI_Comm CART_COMM,
+                                  const int      myid,
+                                  const double   local_origin_x,
+                                  const double   local_origin_y,
+                                  const double   local_origin_z,
+                                  const double   delta,
+                                  const int      NX,         // global nodes along X
+                                  const int      NY,         // global nodes along Y
+                                  const int      NZ,         // global nodes along Z
+                                  const int      offset_x,   // global index of the first local node along X
+                                  const int      offset_y,   // global index of the first local node along Y
+                                  const int      offset_z,   // global index of the first local node along Z
+                                  const int      LX,         // local nodes along X
+                                  const int      LY,         // local nodes along Y
+                                  const int      LZ,         // local nodes along Z
+                                  const int      time,
+                                  const double*  rho,
+                                  output_codec & codec);     // dataset storage settings and statistics
+
+      extern void writeMeshSeries(mesh_series &  series,
+                                  const int      nn,
+                                  const int      myid,
+                                  const int      offset_x,   // global index of the first local node along X
+                                  const int      offset_y,   // global index of the first local node along Y
+                                  const int      offset_z,   // global index of the first local node along Z
+                                  const int      LX,         // local nodes along X
+                                  const int      LY,         // local nodes along Y
+                                  const int      LZ,         // local nodes along Z
+                                  const int      time,
+                                  const double*  rho,
+                                  output_codec & codec);     // dataset storage settings and statistics
+
+      extern void writeMeshSeriesClose(mesh_series & series);
 
 //    MPI 
 
@@ -160,22 +570,90 @@ void domainDecomp3D(// inputs
       int nbr_NORTH;         // id of neighbor in location (j+1)
       int nbr_BOTTOM;        // id of neighbor in location (k-1)
       int nbr_TOP;           // id of neighbor in location (k+1)
+      int thread_provided;   // level of thread support provided by the MPI library
 
 //    LBM parameters
 
+#ifdef LARGE_DOMAIN_TEST
+      // "make large": on one rank, f, f_eq and f_new hold 502^3 x 19 > 2^31 values each, which
+      // exercises the 64-bit lattice indices (about 65 GB; the mass drift is reported at the end)
+      const int NX = 500;        // number of lattice points along X
+      const int NY = 500;        // number of lattice points along Y
+      const int NZ = 500;        // number of lattice points along Z
+#else
       const int NX = 200;        // number of lattice points along X
       const int NY = 50;         // number of lattice points along Y
       const int NZ = 50;         // number of lattice points along Z
+#endif
 
       const double GEE11 = -0.27;     // interaction strength
       const double tau = 1.0;         // relaxation time
       const double rhoAvg = 0.693;    // reference density value
+      const int initial_condition = INIT_CYLINDER;  // INIT_CYLINDER or INIT_SPINODAL
       const int Q = 19;               // number of streaming directions
+#ifdef LARGE_DOMAIN_TEST
+      const int MAXIMUM_TIME = 10;    // for time integration 
+#else
       const int MAXIMUM_TIME = 100;   // for time integration 
+#endif
       const int frame_rate = 10;      // time interval for writing results
+      const int output_mode = OUTPUT_PER_RANK;  // OUTPUT_PER_RANK files, one OUTPUT_SHARED file per frame (MPI-IO),
+                                                // or one OUTPUT_SERIES file per rank with all frames
+      const bool use_async_output = false;      // copy frames to a buffer and write them on a background thread
+      const int io_server_ratio = 0;            // 1 rank in every io_server_ratio ranks writes the output of the others (0 = off)
+      const int output_filter = OUTPUT_FILTER_NONE;  // OUTPUT_FILTER_NONE (contiguous) or _DEFLATE (chunked, shuffle + deflate)
+      const int output_deflate_level = 1;       // 1 (fastest) ... 9 (smallest)
+      const double output_quantize_tol = 0.;    // > 0: round rho to within this error before the filters (lossy)
+      const bool output_benchmark = false;      // write every frame with all benchmark settings and report ratio vs. time
+
+      const bool write_time_series = true;      // rank 0 extends time_series_file after every frame (open it in ParaView)
+      const char time_series_file[] = "../out/time_series.xmf";
+
+      const int checkpoint_interval = 0;        // write the full solver state every checkpoint_interval steps (0 = off)
+      const bool restart_from_checkpoint = false;  // start from checkpoint_file (written on any process grid) instead of the initial condition
+      const char checkpoint_file[] = "../out/checkpoint.bin";  // replaced atomically by every new checkpoint
 
       const double delta = 1.0;  // grid spacing is unity along X and Y
 
+      const int arena_pages = ARENA_PAGES_TRANSPARENT;  // page backing of the field slab (ARENA_PAGES_DEFAULT, _TRANSPARENT, _EXPLICIT)
+      const int arena_numa_node = -1;                   // bind the field slab to this NUMA node (-1: no binding)
+      const bool arena_pad_strides = false;             // pad row and plane strides to avoid cache-set conflicts
+
+      const int halo_codec_mode = HALO_CODEC_NONE;  // PDF halo encoding (HALO_CODEC_NONE, _FP32, _FP16 or _BF16)
+      const double halo_codec_tol = 1.0e-5;         // max. error per PDF value before a message falls back to double
+
+      const bool use_comm_thread = false;  // run all halo exchanges on a dedicated communication thread (needs MPI_THREAD_MULTIPLE)
+
+      const bool use_partitioned_halo = false;  // OpenMP-packed partitioned PDF exchange (always full precision)
+
+      const bool use_blocks = false;    // split the local sub-domain into blocks run by a work-stealing scheduler
+      const int block_size = 32;        // target number of nodes along each edge of a block
+      const int block_threads = 4;      // threads executing block tasks (including the main thread)
+      const bool skip_quiescent = false;        // do not update blocks that sit in a uniform (bulk) state
+      const double quiescent_tol = 1.0e-12;     // max. deviation of rho, f and f_eq from the uniform state
+      const int block_order = BRICK_ORDER_LEXICOGRAPHIC;  // block storage order (BRICK_ORDER_LEXICOGRAPHIC, _MORTON, _HILBERT)
+
+      const int eos_model = EOS_EXPONENTIAL;    // pseudopotential (EOS_EXPONENTIAL, _CARNAHAN_STARLING or _PENG_ROBINSON)
+      const double eos_T_ratio = 0.7;           // temperature T/Tc for the cubic / hard-sphere EOS
+      const bool eos_use_table = false;         // interpolate psi from a lookup table instead of evaluating the EOS
+      const int eos_table_size = 4096;          // number of table entries
+      const double eos_rho_max = 10.0;          // table covers 0 <= rho < eos_rho_max
+
+      const bool use_psi_window = false;        // force kernel reusing psi from a sliding window (calc_dPdtWindow)
+
+      const bool use_narrow_band = false;       // evaluate the cohesive force only near interfaces (rank mode)
+      const int narrow_band_width = 2;          // lattice units kept around every non-uniform node
+      const double narrow_band_tol = 1.0e-12;   // max. difference of rho, u, v, w between uniform neighbors
+
+      const bool use_low_memory = false;        // rank mode without the u, v, w and dPdt fields (collideFused, no narrow band)
+
+      const int nt_stores = NT_STORES_OFF;      // write f_new, f_eq and the f copy around the caches (NT_STORES_OFF, _ON, _AUTO)
+      const int nt_prefetch_distance = 0;       // nodes streaming prefetches ahead on its nine source pencils (0 = off)
+
+      const bool use_autotune = false;          // time the rank-mode kernel variants during the first steps, keep the fastest
+      const int autotune_steps = 3;             // time steps per candidate (the fastest one counts)
+      const char autotune_cache[] = "../out/autotune.txt";  // choices keyed by CPU model and sub-domain size
+
       const double x_min = 0;    // global minimum X coordinate
       const double x_max = NX-1;
       const double y_min = 0;    // global minimum Y coordinate
@@ -197,6 +675,35 @@ void domainDecomp3D(// inputs
       node_range y_range;
       node_range z_range;
 
+      lattice_arena arena;    // memory holding all lattice fields of this process
+
+      halo_codec pdf_codec;   // settings and statistics for the PDF halo exchanges
+
+      comm_thread comm;       // communication thread (owns all halo traffic inside the time loop)
+
+      output_thread output;   // output thread (writes snapshot frames in the background)
+
+      io_server io;           // compute / I/O server split and output shipping
+
+      output_codec out_codec; // storage settings and statistics of the output datasets
+
+      checkpoint_stats ckpt;  // checkpoint and restart statistics
+
+      xdmf_series series;     // global XDMF time series (rank 0)
+
+      mesh_series out_series; // open time-series file of this rank (OUTPUT_SERIES)
+
+      pdf_halo_plan pdf_plan; // buffers and persistent requests for the partitioned PDF exchange
+
+      block_grid grid;        // blocks of the local sub-domain (block mode only)
+      task_scheduler sched;   // threads and task graph advancing the blocks
+
+      eos_table eos;          // equation of state and psi lookup table
+
+      narrow_band band;       // nodes where the cohesive force is evaluated (narrow-band mode only)
+
+      autotuner tuner;        // kernel variant search and choice (rank mode only)
+
 //    D3Q19 directions
 
 //                    0  1  2  3  4  5  6  7  8  9 10 11 12 13 14 15 16 17 18
@@ -6,9 +6,16 @@
                      double* ex, double* ey, double* ez, double tau,
                      double* f, double* f_new, double* f_eq)
       {
+        std::chrono::steady_clock::time_point t_beg = std::chrono::steady_clock::now();
 
-        const int GX = nn + NX + nn;  // size along X including ghost nodes
-        const int GY = nn + NY + nn;  // size along Y including ghost nodes
+        const long long GX = strideX(nn, NX);       // row stride (ghost nodes and padding included)
+        const long long GY = strideY(nn, NX, NY);   // rows per plane (ghost nodes and padding included)
+
+        // f_new is only written here: rows go through a buffer and are stored around the caches
+        const long long interior = (long long) NX*NY*NZ;
+        const bool streamed = streamingStores(19*interior * (long long) sizeof(double));
+        double *row = streamed ? storeRow(19*(long long) NX) : NULL;
+        const int distance = prefetchDistance();
 
         // stream TO all interior nodes
 
@@ -20,11 +27,27 @@
           {
             int J = nn + j;
 
+            long long N0 = nn + GX*J + GX*GY*K;  // first interior node of the row
+            double *dst = streamed ? row : f_new + 19*N0;   // destination of this row's PDFs
+
             for(int i = 0; i < NX; i++)
             {
               int I = nn + i;
 
-              int N = I + GX*J + GX*GY*K;  // streaming destination
+              long long N = I + GX*J + GX*GY*K;  // streaming destination
+
+              if(distance > 0)
+              {
+                // the nine source pencils (J-1..J+1, K-1..K+1), "distance" nodes ahead (not beyond the row)
+                const int ahead = (i + distance < NX) ? distance : NX - 1 - i;
+                for(int dk = -1; dk <= 1; dk++) {
+                  for(int dj = -1; dj <= 1; dj++) {
+                    long long p = 19*(N + ahead + GX*dj + GX*GY*dk);
+                    __builtin_prefetch(f + p);      __builtin_prefetch(f + p + 8);      __builtin_prefetch(f + p + 16);
+                    __builtin_prefetch(f_eq + p);   __builtin_prefetch(f_eq + p + 8);   __builtin_prefetch(f_eq + p + 16);
+                  }
+                }
+              }
 
               for(int id = 0; id < 19; id++)
               {
@@ -32,15 +55,21 @@
                 int jfrom = J - ey[id];
                 int kfrom = K - ez[id];
        
-                int Nfrom = ifrom + GX*jfrom + GX*GY*kfrom;
-                int f_index_end = 19*N + id; 
-                int f_index_beg = 19*Nfrom + id;
+                long long Nfrom = ifrom + GX*jfrom + GX*GY*kfrom;
+                long long f_index_end = 19*(N - N0) + id;   // within the row
+                long long f_index_beg = 19*Nfrom + id;
         
-                f_new[f_index_end] = f[f_index_beg]
-                                   - (f[f_index_beg] - f_eq[f_index_beg])
-                                   / tau;
+                dst[f_index_end] = f[f_index_beg]
+                                 - (f[f_index_beg] - f_eq[f_index_beg])
+                                 / tau;
               }
             }
+
+            if(streamed) streamStore(f_new + 19*N0, row, 19*(long long) NX);
           }
         }
+
+        if(streamed) storeFence();
+        trafficAdd(TRAFFIC_STREAMING, t_beg, 2*19*interior * (long long) sizeof(double),
+                   19*interior * (long long) sizeof(double), streamed);
       }
@@ -0,0 +1,218 @@
+#include "taskScheduler.h"
+
+/**
+Work-stealing scheduler for a static task graph
+
+The graph is built once (schedulerAddTask, schedulerAddDependency) and run
+once per time step (schedulerRun). A task becomes ready when all its
+predecessors in the current step have finished and all of its external
+events (for example an MPI message that has arrived) have been signalled with
+schedulerRelease.
+
+Every thread owns a queue of ready tasks. Tasks released by a finishing task
+go to the queue of the thread that ran it, so data that is still in cache gets
+reused. A thread whose queue is empty steals the oldest task from another
+thread.
+
+The calling thread takes part in the work and is the only one that calls the
+"poll" function, so MPI is only ever used by the calling thread
+(MPI_THREAD_FUNNELED is sufficient).
+*/
+
+// take a task from my own queue, or steal one from another thread (-1 if there is none)
+
+static int nextTask(task_scheduler & sched, const int id)
+{
+    {
+        ready_queue & own = sched.queues[id];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if(!own.tasks.empty())
+        {
+            int t = own.tasks.back();
+            own.tasks.pop_back();
+            return t;
+        }
+    }
+
+    for(int n = 1; n < sched.num_threads; n++)
+    {
+        ready_queue & victim = sched.queues[(id + n) % sched.num_threads];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if(!victim.tasks.empty())
+        {
+            int t = victim.tasks.front();
+            victim.tasks.pop_front();
+            sched.stolen[id]++;
+            return t;
+        }
+    }
+
+    return -1;
+}
+
+// satisfy one dependency of task t, queue it on thread "id" once it is ready
+
+static void satisfy(task_scheduler & sched, const int t, const int id)
+{
+    if(--sched.tasks[t].deps_left == 0)
+    {
+        ready_queue & queue = sched.queues[id];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(t);
+    }
+}
+
+// execute tasks until every task of the current step has finished
+
+static void workLoop(task_scheduler & sched, const int id, const std::function<void()> * poll)
+{
+    while(sched.remaining > 0)
+    {
+        if(poll) (*poll)();
+
+        int t = nextTask(sched, id);
+        if(t < 0)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        sched_task & task = sched.tasks[t];
+        task.run();
+        sched.executed[id]++;
+
+        for(size_t s = 0; s < task.successors.size(); s++) satisfy(sched, task.successors[s], id);
+
+        sched.remaining--;
+    }
+}
+
+// body of worker threads 1 .. num_threads-1
+
+static void workerMain(task_scheduler * sched, const int id)
+{
+    int seen = 0;
+
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(sched->mutex);
+            sched->start.wait(lock, [sched, seen]{ return sched->shutdown || sched->generation != seen; });
+            if(sched->shutdown) return;
+            seen = sched->generation;
+        }
+
+        workLoop(*sched, id, NULL);
+        sched->active--;
+    }
+}
+
+// create the worker threads
+
+void schedulerStart(task_scheduler & sched, const int num_threads)
+{
+    sched.num_threads = (num_threads > 0) ? num_threads : 1;
+    sched.generation  = 0;
+    sched.shutdown    = false;
+    sched.remaining   = 0;
+    sched.active      = 0;
+    for(int id = 0; id < sched.num_threads; id++) sched.queues.emplace_back();
+    sched.executed.assign(sched.num_threads, 0);
+    sched.stolen.assign(sched.num_threads, 0);
+
+    for(int id = 1; id < sched.num_threads; id++)
+    {
+        sched.workers.push_back(std::thread(workerMain, &sched, id));
+    }
+}
+
+// add a task with "external_deps" events that must be signalled (schedulerRelease) every step
+
+int schedulerAddTask(task_scheduler & sched, const std::function<void()> & run, const int external_deps)
+{
+    sched.tasks.emplace_back();
+    sched_task & task = sched.tasks.back();
+    task.run       = run;
+    task.num_deps  = external_deps;
+    task.deps_left = 0;
+    return (int) sched.tasks.size() - 1;
+}
+
+// task "after" cannot start before task "before" has finished
+
+void schedulerAddDependency(task_scheduler & sched, const int before, const int after)
+{
+    sched.tasks[before].successors.push_back(after);
+    sched.tasks[after].num_deps++;
+}
+
+// signal an external event for task t (only from the calling thread, e.g. inside poll)
+
+void schedulerRelease(task_scheduler & sched, const int t)
+{
+    satisfy(sched, t, 0);
+}
+
+// run every task of the graph once; poll is called repeatedly by the calling thread
+
+void schedulerRun(task_scheduler & sched, const std::function<void()> & poll)
+{
+    // reset dependency counters and spread the initially ready tasks over all threads
+
+    int q = 0;
+    sched.remaining = (int) sched.tasks.size();
+    for(size_t t = 0; t < sched.tasks.size(); t++)
+    {
+        sched.tasks[t].deps_left = sched.tasks[t].num_deps;
+        if(sched.tasks[t].num_deps == 0)
+        {
+            sched.queues[q].tasks.push_back((int) t);
+            q = (q + 1) % sched.num_threads;
+        }
+    }
+
+    // wake the workers and join in
+
+    sched.active = sched.num_threads - 1;
+    {
+        std::lock_guard<std::mutex> lock(sched.mutex);
+        sched.generation++;
+    }
+    sched.start.notify_all();
+
+    workLoop(sched, 0, &poll);
+
+    // nobody may still be looking at the queues when the next step resets them
+
+    while(sched.active > 0) std::this_thread::yield();
+}
+
+// stop and join the worker threads
+
+void schedulerStop(task_scheduler & sched)
+{
+    {
+        std::lock_guard<std::mutex> lock(sched.mutex);
+        sched.shutdown = true;
+    }
+    sched.start.notify_all();
+
+    for(size_t n = 0; n < sched.workers.size(); n++) sched.workers[n].join();
+    sched.workers.clear();
+}
+
+// print how the work was spread over the threads
+
+void schedulerReport(const task_scheduler & sched, const int myid)
+{
+    if(myid != 0) return;
+
+    std::cout << std::endl;
+    std::cout << "task scheduler threads  : " << sched.num_threads
+              << " (" << sched.tasks.size() << " tasks per step)" << std::endl;
+    for(int id = 0; id < sched.num_threads; id++)
+    {
+        std::cout << "  thread " << id << " : " << sched.executed[id] << " tasks executed, "
+                  << sched.stolen[id] << " stolen" << std::endl;
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <iostream>
+#include <vector>
+#include <deque>                // std::deque
+#include <thread>               // std::thread
+#include <mutex>                // std::mutex
+#include <condition_variable>   // std::condition_variable
+#include <atomic>               // std::atomic
+#include <functional>           // std::function
+
+// one node of the task graph (the graph is built once and executed every time step)
+
+struct sched_task
+{
+    std::function<void()> run;          // work done by this task
+    std::vector<int>      successors;   // tasks that depend on this one
+    int                   num_deps;     // dependencies per step (predecessor tasks + external events)
+    std::atomic<int>      deps_left;    // dependencies still outstanding in the current step
+};
+
+// double-ended queue of ready tasks owned by one thread
+// (the owner works at the back, thieves take from the front)
+
+struct ready_queue
+{
+    std::mutex      mutex;
+    std::deque<int> tasks;
+};
+
+struct task_scheduler
+{
+    int                         num_threads;   // worker threads including the calling thread
+    std::deque<sched_task>      tasks;         // the task graph
+    std::deque<ready_queue>     queues;        // one ready queue per thread
+    std::vector<std::thread>    workers;       // threads 1 .. num_threads-1
+    std::atomic<int>            remaining;     // tasks not yet finished in the current step
+    std::atomic<int>            active;        // worker threads still inside the current step
+    std::mutex                  mutex;         // protects generation and shutdown
+    std::condition_variable     start;         // wakes the workers at the beginning of a step
+    int                         generation;    // number of steps started
+    bool                        shutdown;      // tells the workers to exit
+    std::vector<long long>      executed;      // tasks executed by each thread
+    std::vector<long long>      stolen;        // tasks stolen by each thread
+};
+
+#endif
@@ -0,0 +1,272 @@
+#include "timeSeries.h"
+
+/**
+Incremental XDMF time series
+
+Rank 0 keeps one XDMF file describing every frame written so far: a temporal
+collection whose members are spatial collections of the blocks of a frame.
+All ranks report their block (global offset and size) once at startup, so
+rank 0 can describe each frame from the known decomposition without any
+communication or file system queries.
+
+A frame is appended by writing its entry over the closing tags and writing
+the closing tags again behind it, so the file is valid after every frame and
+each append costs one small write, however long the run is.
+
+A frame is only appended once its files are complete on every rank, so a
+reader never follows an entry into a file that is still being written. With
+asynchronous output or I/O servers the solver hands a frame over and moves
+on: rank 0 queues it, and at every later frame step all ranks report the
+last frame their writer (output thread or I/O server) has finished. Frames
+up to the oldest of those are appended; in a steady run that is one frame
+behind. The rest follow once the writers have been shut down.
+
+After a restart the entries up to the restart time are kept and the frames
+of the new run are appended behind them.
+*/
+
+static const char series_frame_tag[] = "<Grid Name=\"frame ";
+static const char series_footer[]    = "</Grid> <!-- time series ends -->\n</Domain>\n</Xdmf>\n";
+
+// one uniform grid (same light data as the per-frame XDMF files of writeMesh);
+// with slab >= 0 the data is frame "slab" of a frames x LZ x LY x LX dataset
+
+static void writeGrid(std::ostream & XDMF, const std::string & mesh_name,
+                      const int LX, const int LY, const int LZ,
+                      const double origin_x, const double origin_y, const double origin_z,
+                      const double delta, const std::string & data, const int slab)
+{
+    XDMF << "    <Grid Name=\"mesh " << mesh_name << "\" GridType=\"Uniform\">\n";
+    XDMF << "        <Topology TopologyType=\"3DCoRectMesh\" Dimensions=\"" << LZ << " " << LY << " " << LX << "\" >\n";
+    XDMF << "        </Topology>\n";
+    XDMF << "        <Geometry GeometryType=\"ORIGIN_DXDYDZ\">\n";
+    XDMF << "            <DataItem Format=\"XML\" NumberType=\"Float\" Dimensions=\"3\">\n";
+    XDMF << "                " << origin_z << " " << origin_y << " " << origin_x << "\n";
+    XDMF << "            </DataItem>\n";
+    XDMF << "            <DataItem Format=\"XML\" NumberType=\"Float\" Dimensions=\"3\">\n";
+    XDMF << "                " << delta << " " << delta << " " << delta << "\n";
+    XDMF << "            </DataItem>\n";
+    XDMF << "        </Geometry>\n";
+    XDMF << "        <Attribute Name=\"rho\" AttributeType=\"Scalar\" Center=\"Node\">\n";
+    if(slab < 0)
+    {
+        XDMF << "            <DataItem Dimensions=\"" << LZ << " " << LY << " " << LX << "\" Precision=\" 8 \" Format=\"HDF\">\n";
+        XDMF << "                " << data << "\n";
+        XDMF << "            </DataItem>\n";
+    }
+    else
+    {
+        XDMF << "            <DataItem ItemType=\"HyperSlab\" Dimensions=\"" << LZ << " " << LY << " " << LX << "\" Type=\"HyperSlab\">\n";
+        XDMF << "                <DataItem Dimensions=\"3 4\" Format=\"XML\">\n";
+        XDMF << "                    " << slab << " 0 0 0  1 1 1 1  1 " << LZ << " " << LY << " " << LX << "\n";
+        XDMF << "                </DataItem>\n";
+        XDMF << "                <DataItem Dimensions=\"" << slab + 1 << " " << LZ << " " << LY << " " << LX << "\" Precision=\" 8 \" Format=\"HDF\">\n";
+        XDMF << "                    " << data << "\n";
+        XDMF << "                </DataItem>\n";
+        XDMF << "            </DataItem>\n";
+    }
+    XDMF << "        </Attribute>\n";
+    XDMF << "    </Grid>\n";
+}
+
+// collect the decomposition on rank 0 and start (or continue) the time series file
+
+void timeSeriesSetup(xdmf_series &  series,
+                     const bool     enable,
+                     const char*    file_name,
+                     const int      layout,
+                     const int      server_id,
+                     const int      x_beg,
+                     const int      y_beg,
+                     const int      z_beg,
+                     const int      LX,
+                     const int      LY,
+                     const int      LZ,
+                     const int      NX,
+                     const int      NY,
+                     const int      NZ,
+                     const double   local_origin_x,
+                     const double   local_origin_y,
+                     const double   local_origin_z,
+                     const double   delta,
+                     const int      restart_time,
+                     const int      myid,
+                     const MPI_Comm CART_COMM)
+{
+    series.enabled    = enable && myid == 0;
+    series.file_name  = file_name;
+    series.layout     = layout;
+    series.NX         = NX;
+    series.NY         = NY;
+    series.NZ         = NZ;
+    series.origin[0]  = local_origin_x - x_beg*delta;
+    series.origin[1]  = local_origin_y - y_beg*delta;
+    series.origin[2]  = local_origin_z - z_beg*delta;
+    series.delta      = delta;
+    series.footer_pos = 0;
+    series.frames     = 0;
+    series.first_time = 0;
+    series.confirm    = enable;
+    series.pending.clear();
+
+    if(!enable) return;
+
+    int world_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+
+    int numprocs;
+    MPI_Comm_size(CART_COMM, &numprocs);
+
+    series_block mine = {x_beg, y_beg, z_beg, LX, LY, LZ, world_rank, server_id};
+    series.blocks.resize(myid == 0 ? numprocs : 0);
+    MPI_Gather(&mine, sizeof(series_block), MPI_BYTE,
+               series.blocks.data(), sizeof(series_block), MPI_BYTE, 0, CART_COMM);
+
+    if(!series.enabled) return;
+
+    // a restarted run keeps the frames up to the restart time
+    std::string kept;
+    if(restart_time >= 0)
+    {
+        std::ifstream old(series.file_name.c_str());
+        if(old)
+        {
+            std::stringstream text_stream;
+            text_stream << old.rdbuf();
+            std::string text = text_stream.str();
+
+            size_t cut = text.find(series_footer);
+            size_t pos = text.find(series_frame_tag);
+            while(pos != std::string::npos && pos < cut)
+            {
+                if(atoi(text.c_str() + pos + sizeof(series_frame_tag) - 1) > restart_time)
+                {
+                    cut = pos;
+                    break;
+                }
+                pos = text.find(series_frame_tag, pos + 1);
+            }
+            if(cut != std::string::npos) kept = text.substr(0, cut);
+        }
+    }
+
+    if(kept.empty())
+    {
+        std::stringstream header;
+        header << "<?xml version=\"1.0\" ?>\n";
+        header << "<!DOCTYPE Xdmf SYSTEM \"Xdmf.dtd\" []>\n";
+        header << "<Xdmf version = \"2.0\">\n";
+        header << "<Domain>\n";
+        header << "<Grid Name=\"time series\" GridType=\"Collection\" CollectionType=\"Temporal\">\n";
+        kept = header.str();
+    }
+
+    std::ofstream XDMF(series.file_name.c_str(), std::ios::trunc);
+    if(XDMF.fail())
+    {
+        std::cout << "ERROR: could not open " << series.file_name << " for the XDMF time series" << std::endl;
+        series.enabled = false;
+        return;
+    }
+    XDMF << kept;
+    series.footer_pos = (long long) kept.size();
+    XDMF << series_footer;
+}
+
+// rank 0: add the frame of lattice time "time" to the time series
+
+static void timeSeriesAppend(xdmf_series & series, const int time)
+{
+    if(!series.enabled) return;
+
+    if(series.frames == 0) series.first_time = time;
+
+    std::stringstream frame;
+    frame << std::setw(6) << std::setfill('0') << time;
+
+    std::stringstream entry;
+    entry << series_frame_tag << frame.str() << "\" GridType=\"Collection\" CollectionType=\"Spatial\">\n";
+    entry << "<Time Value = \"" << time << "\" />\n";
+
+    if(series.layout == SERIES_SHARED)
+    {
+        writeGrid(entry, "global", series.NX, series.NY, series.NZ,
+                  series.origin[0], series.origin[1], series.origin[2], series.delta,
+                  "./hdf5/data_t_" + frame.str() + ".h5:/rho", -1);
+    }
+    else
+    {
+        for(size_t r = 0; r < series.blocks.size(); r++)
+        {
+            const series_block & b = series.blocks[r];
+
+            std::stringstream mesh_name, data;
+            if(series.layout == SERIES_IO)
+            {
+                mesh_name << "mpi_" << std::setw(3) << std::setfill('0') << b.world_rank;
+                data << "./hdf5/data_t_" << frame.str() << "_io_" << std::setw(3) << std::setfill('0') << b.server_id
+                     << ".h5:/rho_" << mesh_name.str();
+            }
+            else if(series.layout == SERIES_APPEND)
+            {
+                mesh_name << "mpi_" << std::setw(3) << std::setfill('0') << r;
+                data << "./hdf5/series_t_" << std::setw(6) << std::setfill('0') << series.first_time
+                     << "_" << mesh_name.str() << ".h5:/rho";
+            }
+            else
+            {
+                mesh_name << "mpi_" << std::setw(3) << std::setfill('0') << r;
+                data << "./hdf5/data_t_" << frame.str() << "_" << mesh_name.str() << ".h5:/rho";
+            }
+
+            writeGrid(entry, mesh_name.str(), b.LX, b.LY, b.LZ,
+                      series.origin[0] + b.offset_x*series.delta,
+                      series.origin[1] + b.offset_y*series.delta,
+                      series.origin[2] + b.offset_z*series.delta,
+                      series.delta, data.str(), series.layout == SERIES_APPEND ? series.frames : -1);
+        }
+    }
+    entry << "</Grid>\n";
+
+    // overwrite the closing tags with the new frame and close the collection again
+    std::fstream XDMF(series.file_name.c_str(), std::ios::in | std::ios::out);
+    if(XDMF.fail())
+    {
+        std::cout << "ERROR: could not open " << series.file_name << " for the XDMF time series" << std::endl;
+        return;
+    }
+    XDMF.seekp(series.footer_pos);
+    XDMF << entry.str();
+    series.footer_pos = (long long) XDMF.tellp();
+    XDMF << series_footer;
+
+    series.frames++;
+}
+
+// rank 0: remember a frame handed to the writers (listed once timeSeriesConfirm finds it complete)
+
+void timeSeriesPost(xdmf_series & series, const int time)
+{
+    if(series.enabled) series.pending.push_back(time);
+}
+
+// all ranks: "written" is the lattice time of the last frame this rank's writer has finished (-1: none);
+// rank 0 appends the pending frames finished on every rank
+
+void timeSeriesConfirm(xdmf_series & series, const int written, const MPI_Comm CART_COMM)
+{
+    if(!series.confirm) return;
+
+    int complete;
+    MPI_Reduce(&written, &complete, 1, MPI_INT, MPI_MIN, 0, CART_COMM);
+
+    if(!series.enabled) return;
+
+    size_t n = 0;
+    while(n < series.pending.size() && series.pending[n] <= complete)
+    {
+        timeSeriesAppend(series, series.pending[n]);
+        n++;
+    }
+    series.pending.erase(series.pending.begin(), series.pending.begin() + n);
+}
@@ -0,0 +1,52 @@
+#ifndef TIME_SERIES_H
+#define TIME_SERIES_H
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cstdlib>    // atoi
+#include <mpi.h>      // MPI header files
+
+// global XDMF time series (../out/time_series.xmf), extended by rank 0 after every frame
+//
+// the file is complete XML after every append, so ParaView can open (and reload) it while
+// the run is still going; a frame is only listed once its files are complete on every rank
+
+enum
+{
+    SERIES_PER_RANK = 0,   // one HDF5 file per rank and frame (writeMesh)
+    SERIES_SHARED   = 1,   // one HDF5 file per frame holding the global array (writeMeshShared)
+    SERIES_IO       = 2,   // one HDF5 file per I/O server and frame, one dataset per client (ioServer)
+    SERIES_APPEND   = 3    // one HDF5 file per rank and run, frames along an unlimited axis (writeMeshSeries)
+};
+
+// where one compute rank's block sits and which files hold it
+
+struct series_block
+{
+    int offset_x, offset_y, offset_z;   // global index of the first interior node
+    int LX, LY, LZ;                     // interior nodes
+    int world_rank;                     // rank in MPI_COMM_WORLD (names the dataset on an I/O server)
+    int server_id;                      // I/O server writing the block (SERIES_IO)
+};
+
+struct xdmf_series
+{
+    bool                      enabled;     // rank 0 maintains the file
+    std::string               file_name;
+    int                       layout;      // SERIES_*
+    int                       NX, NY, NZ;  // global lattice
+    double                    origin[3];   // coordinates of global node (0,0,0), X Y Z
+    double                    delta;       // grid spacing
+    std::vector<series_block> blocks;      // every compute rank, in CART_COMM order
+    long long                 footer_pos;  // byte position of the closing tags
+    int                       frames;      // frames indexed by this run
+    int                       first_time;  // lattice time of the first of them (names the SERIES_APPEND files)
+    bool                      confirm;     // all ranks: completed frames are reported to rank 0
+    std::vector<int>          pending;     // frames handed to the writers, not yet complete everywhere
+};
+
+#endif
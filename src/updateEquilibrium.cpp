@@ -8,8 +8,15 @@
                              const double* u, const double* v, const double* w,
                              double* f_eq)
       {
-        const int GX = nn + NX + nn;
-        const int GY = nn + NY + nn;
+        std::chrono::steady_clock::time_point t_beg = std::chrono::steady_clock::now();
+
+        const long long GX = strideX(nn, NX);
+        const long long GY = strideY(nn, NX, NY);
+
+        // f_eq is only written here: rows go through a buffer and are stored around the caches
+        const long long interior = (long long) NX*NY*NZ;
+        const bool streamed = streamingStores(19*interior * (long long) sizeof(double));
+        double *row = streamed ? storeRow(19*(long long) NX) : NULL;
 
         for(int k = 0; k < NZ; k++)
         {  
@@ -17,20 +24,27 @@
           for(int j = 0; j < NY; j++)
           {  
             int J = nn+j;
+            long long N0 = nn + GX*J + GX*GY*K;
+            double *dst = streamed ? row : f_eq + 19*N0;   // destination of this row's PDFs
             for(int i = 0; i < NX; i++)
             {
               int I = nn+i;
-              int N = I + GX*J + GX*GY*K;
+              long long N = I + GX*J + GX*GY*K;
               double udotu = u[N]*u[N] + v[N]*v[N] + w[N]*w[N];
               for(int id = 0; id < 19; id++)
               {
-                int index_f = 19*N + id;
+                long long index_f = 19*(N - N0) + id;   // within the row
                 double edotu = ex[id]*u[N] + ey[id]*v[N] + ez[id]*w[N];
-                f_eq[index_f] = wt[id] * rho[N] 
-                              * (1 + 3*edotu
-                                   + 4.5*edotu*edotu - 1.5*udotu);
+                dst[index_f] = wt[id] * rho[N] 
+                             * (1 + 3*edotu
+                                  + 4.5*edotu*edotu - 1.5*udotu);
               }
             }
+            if(streamed) streamStore(f_eq + 19*N0, row, 19*(long long) NX);
           }
         }
+
+        if(streamed) storeFence();
+        trafficAdd(TRAFFIC_EQUILIBRIUM, t_beg, 4*interior * (long long) sizeof(double),
+                   19*interior * (long long) sizeof(double), streamed);
       }
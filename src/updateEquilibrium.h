@@ -3,4 +3,7 @@
 
       #include<iostream>
 
+      #include "latticeArena.h"  // strideX, strideY
+      #include "nonTemporal.h"   // streaming stores, traffic counters
+
 #endif
@@ -9,8 +9,8 @@
                        double* dPdt_x, double* dPdt_y, double* dPdt_z,
                        double* f)
       { 
-        const int GX = nn + NX + nn;
-        const int GY = nn + NY + nn;
+        const long long GX = strideX(nn, NX);
+        const long long GY = strideY(nn, NX, NY);
 
         // update density and velocity
         for(int k = 0; k < NZ; k++)
@@ -22,14 +22,14 @@
             for(int i = 0; i < NX; i++)
             { 
               int I = nn+i;
-              int N = I + GX*J + GX*GY*K;
+              long long N = I + GX*J + GX*GY*K;
               double f_sum = 0;
               double fex_sum = 0;
               double fey_sum = 0;
               double fez_sum = 0;
               for(int id = 0; id < 19; id++)
               {
-                int f_index = 19*N + id;
+                long long f_index = 19*N + id;
                 f_sum   += f[f_index];
                 fex_sum += f[f_index]*ex[id];
                 fey_sum += f[f_index]*ey[id];
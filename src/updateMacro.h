@@ -3,4 +3,6 @@
 
       #include<iostream>
 
+      #include "latticeArena.h"  // strideX, strideY
+
 #endif
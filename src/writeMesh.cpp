@@ -11,41 +11,22 @@ void writeMesh(const int      nn,
                const double   local_origin_y, 
                const double   local_origin_z, 
                const double   delta,
+               const int      offset_x,   // global index of the first local node along X
+               const int      offset_y,   // global index of the first local node along Y
+               const int      offset_z,   // global index of the first local node along Z
                const int      LX,
                const int      LY,
                const int      LZ,
                const int      time,
-               const double*  rho)
+               const double*  rho,
+               output_codec & codec)      // dataset storage settings and statistics
 {
     std::cout << "writing data to output files for t = " << time << std::endl;
 
-    const int GX = nn + LX + nn;    // size along X including ghost nodes
-    const int GY = nn + LY + nn;    // size along Y including ghost nodes
-    const int GZ = nn + LZ + nn;    // size along Z including ghost nodes
+    const long long GZ = nn + LZ + nn;    // size along Z including ghost nodes
 
-    // create a 1D array of X-Y-Z coordinates for this process
-    // these are "NODE CENTERED" values at the vertices of the voxels
-
-    float *xyz = new float [GX*GY*GZ*3];
-
-    // "natural" index of the "3D" array
-
-    int ndx = 0; 
-
-    // begin for loop to populate xyz
-
-    for (int k = 0; k < GZ; k++)
-    {
-        for (int j = 0; j < GY; j++)
-        {
-            for (int i = 0; i < GX; i++)
-            {
-                xyz[ndx++] = local_origin_x - delta + (float) i * delta;
-                xyz[ndx++] = local_origin_y - delta + (float) j * delta;
-                xyz[ndx++] = local_origin_z - delta + (float) k * delta;
-            }
-        }
-    }
+    const long long SX = strideX(nn, LX);       // row stride of rho (may be padded beyond GX)
+    const long long SY = strideY(nn, LX, LY);   // rows per plane of rho (may be padded beyond GY)
 
     // CREATE FILES (file name includes MPI rank and lattice time)
     //
@@ -54,77 +35,79 @@ void writeMesh(const int      nn,
     std::stringstream file_name;
     file_name << "t_" << std::setw(6) << std::setfill('0') << time << "_mpi_" << std::setw(3) << std::setfill('0') << myid;
 
-    // create HDF5 files to store heavy data (mesh --> x y z coordinates of voxel vertices)
-    //                                       (attribute --> fluid density, rho)
+    // create HDF5 files to store heavy data (attribute --> fluid density, rho)
+    // the mesh is a uniform grid described in the XDMF file by its origin and spacing alone
 
     hid_t   file_id, dataset;      // file and dataset handles
-    hid_t   datatype, dataspace;   // handles
-    hsize_t dimsf[1];              // dataset dimensions
+    hsize_t dimsf[3];              // dataset dimensions
     herr_t  status;
 
-    // we will write (contiguous) 1D array data for both the mesh and for the attribute (rho)
-    const int RANK = 1;
+    // we will write the interior nodes (LX x LY x LZ) as a 3D array, Z slowest
+    const int RANK = 3;
 
     std::string hdf5_file_with_path = "../out/hdf5/data_" + file_name.str() + ".h5";
     std::string hdf5_file = "data_" + file_name.str() + ".h5";
     file_id = H5Fcreate(hdf5_file_with_path.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
 
-    // MESH DATA
+    // NODE CENTERED DATA (rho)
     {
-        // describe the size of the array and create the data space for fixed size dataset
-        dimsf[0] = GX*GY*GZ*3;
-        dataspace = H5Screate_simple(RANK, dimsf, NULL);
+        // describe the size of the array
+        dimsf[0] = LZ;
+        dimsf[1] = LY;
+        dimsf[2] = LX;
 
-        // define datatype for the data in the file
-        // we will store floating point numbers
+        // interior copy, only made if the values are quantized (or benchmarked) before writing
 
-        datatype = H5Tcopy(H5T_NATIVE_FLOAT);
-        status = H5Tset_order(datatype, H5T_ORDER_LE);
+        const double *packed = outputCodecPack(codec, rho, SX, SY, nn, LX, LY, LZ, myid);
 
-        // create a new dataset within the file using defined dataspace and datatype and default dataset creation properties
-    
-        dataset = H5Dcreate2(file_id, "/xyz", datatype, dataspace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+        // create a new dataset within the file: little-endian doubles, contiguous or chunked and compressed (see outputCodec.cpp)
 
-        // write the mesh data to the dataset using default transfer properties
+        double t_beg = MPI_Wtime();
+        dataset = outputCodecCreate(codec, file_id, "/rho", dimsf);
 
-        status = H5Dwrite(dataset, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, xyz);
-    }
+        if(packed)
+        {
+            status = H5Dwrite(dataset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, packed);
+        }
+        else
+        {
+            // rho in memory: the LX x LY x LZ interior of a ghosted (and possibly padded) SX x SY x GZ array
+            // (HDF5 gathers the interior itself, no copy is made)
 
-    // NODE CENTERED DATA (rho)
-    {
-        // describe the size of the array and create the data space for fixed size dataset
-        dimsf[0] = GX*GY*GZ;
-        dataspace = H5Screate_simple(RANK, dimsf, NULL);
+            hsize_t dimsm[3]  = {(hsize_t) GZ, (hsize_t) SY, (hsize_t) SX};
+            hsize_t start[3]  = {(hsize_t) nn, (hsize_t) nn, (hsize_t) nn};
+            hid_t   memspace  = H5Screate_simple(RANK, dimsm, NULL);
+            status = H5Sselect_hyperslab(memspace, H5S_SELECT_SET, start, NULL, dimsf, NULL);
 
-        // define datatype for the data in the file
-        // we will store double precision numbers
+            // write the density data to the dataset using default transfer properties
 
-        datatype = H5Tcopy(H5T_NATIVE_DOUBLE);
-        status = H5Tset_order(datatype, H5T_ORDER_LE);
+            status = H5Dwrite(dataset, H5T_NATIVE_DOUBLE, memspace, H5S_ALL, H5P_DEFAULT, rho);
 
-        // create a new dataset within the file using defined dataspace and datatype and default dataset creation properties
+            H5Sclose(memspace);
+        }
+
+        outputCodecRecord(codec, dataset, (double) LX*LY*LZ * sizeof(double), MPI_Wtime() - t_beg);
 
-        dataset = H5Dcreate2(file_id, "/rho", datatype, dataspace, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+        // position of this block in the global NZ x NY x NX lattice (same Z, Y, X order as the dataset)
 
-        // write the density data to the dataset using default transfer properties
+        int     offset[3]  = {offset_z, offset_y, offset_x};
+        hsize_t dimsa[1]   = {3};
+        hid_t   attrspace  = H5Screate_simple(1, dimsa, NULL);
+        hid_t   attribute  = H5Acreate2(dataset, "global_offset", H5T_STD_I32LE, attrspace, H5P_DEFAULT, H5P_DEFAULT);
+        status = H5Awrite(attribute, H5T_NATIVE_INT, offset);
 
-        status = H5Dwrite(dataset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, rho);
+        H5Aclose(attribute);
+        H5Sclose(attrspace);
     }
 
     // release resources
 
-    H5Sclose(dataspace);
-    H5Tclose(datatype);
     H5Dclose(dataset);
 
     // close the HDF5 file
 
     H5Fclose(file_id);
 
-    // free allocated memory
-
-    delete [] xyz;
-
     // create XDMF file containing information about the mesh (light data)
 
     std::ofstream XDMF;
@@ -144,15 +127,18 @@ void writeMesh(const int      nn,
     mesh_name << "mpi_" << std::setw(3) << std::setfill('0') << myid;
 
     XDMF << "    <Grid Name=\"mesh " << mesh_name.str() << "\" GridType=\"Uniform\">\n";
-    XDMF << "        <Topology TopologyType=\"3DSMesh\" NumberOfElements=\"" << GZ << " " << GY << " " << GX << "\" >\n";
+    XDMF << "        <Topology TopologyType=\"3DCoRectMesh\" Dimensions=\"" << LZ << " " << LY << " " << LX << "\" >\n";
     XDMF << "        </Topology>\n";
-    XDMF << "        <Geometry GeometryType=\"XYZ\">\n";
-    XDMF << "            <DataItem Format=\"HDF\" Precision=\" 4 \" Dimensions=\"" << GZ*GY*GX << " " << " 3 \">\n";
-    XDMF << "                " << "./hdf5/" << hdf5_file << ":/xyz\n";
+    XDMF << "        <Geometry GeometryType=\"ORIGIN_DXDYDZ\">\n";
+    XDMF << "            <DataItem Format=\"XML\" NumberType=\"Float\" Dimensions=\"3\">\n";
+    XDMF << "                " << local_origin_z << " " << local_origin_y << " " << local_origin_x << "\n";
+    XDMF << "            </DataItem>\n";
+    XDMF << "            <DataItem Format=\"XML\" NumberType=\"Float\" Dimensions=\"3\">\n";
+    XDMF << "                " << delta << " " << delta << " " << delta << "\n";
     XDMF << "            </DataItem>\n";
     XDMF << "        </Geometry>\n";
     XDMF << "        <Attribute Name=\"rho\" AttributeType=\"Scalar\" Center=\"Node\">\n";
-    XDMF << "            <DataItem Dimensions=\"" << GZ << " " << GY << " " << GX << "\" Precision=\" 8 \" Format=\"HDF\">\n";
+    XDMF << "            <DataItem Dimensions=\"" << LZ << " " << LY << " " << LX << "\" Precision=\" 8 \" Format=\"HDF\">\n";
     XDMF << "                " << "./hdf5/" << hdf5_file << ":/rho\n";
     XDMF << "            </DataItem>\n";
     XDMF << "        </Attribute>\n";
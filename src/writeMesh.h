@@ -5,7 +5,53 @@
 #include <fstream>
 #include <sstream>
 #include <iomanip>
+#include <string>
 
 #include "hdf5.h"     // along with HDF5, this automatically includes the necessary mpi header files
 
+#include "latticeArena.h"  // workspace, strideX, strideY
+#include "outputCodec.h"   // output_codec, outputCodecCreate
+
+// how a frame is distributed over files
+
+enum
+{
+    OUTPUT_PER_RANK = 0,   // one HDF5 + XDMF file per rank and frame
+    OUTPUT_SHARED   = 1,   // one HDF5 file per frame, the dataset written collectively with MPI-IO
+    OUTPUT_SERIES   = 2    // one HDF5 file per rank and run, every frame appended along an unlimited time axis
+};
+
+// handles of the time-series file of a rank, kept open from the first frame to the end of the run
+
+struct mesh_series
+{
+    bool        open;          // file and datasets below are valid
+    hid_t       file_id;       // series_t_<first frame>_mpi_<rank>.h5
+    hid_t       dataset;       // /rho, frames x LZ x LY x LX
+    hid_t       times;         // /time, lattice time of every frame
+    hid_t       memspace;      // interior of the ghosted (and padded) rho buffer
+    hid_t       packed_space;  // a packed LZ x LY x LX frame (quantized output)
+    hsize_t     frames;        // frames appended
+    double      stored;        // storage size of /rho after the last frame
+};
+
+// one frame of this rank in files of its own (writeMesh.cpp; also the fallback of writeMeshShared)
+
+extern void writeMesh(const int      nn,
+                      const MPI_Comm CART_COMM, 
+                      const int      myid, 
+                      const double   local_origin_x, 
+                      const double   local_origin_y, 
+                      const double   local_origin_z, 
+                      const double   delta, 
+                      const int      offset_x,   // global index of the first local node along X
+                      const int      offset_y,   // global index of the first local node along Y
+                      const int      offset_z,   // global index of the first local node along Z
+                      const int      NX, 
+                      const int      NY, 
+                      const int      NZ, 
+                      const int      time,
+                      const double*  rho,
+                      output_codec & codec);     // dataset storage settings and statistics
+
 #endif
@@ -0,0 +1,129 @@
+#include "writeMesh.h"
+
+// this function appends one frame of this rank to its time-series file
+// the file is created with the first frame and stays open until writeMeshSeriesClose:
+// /rho holds the interior nodes of every frame (frames x LZ x LY x LX, one chunk per frame)
+// and /time the lattice time of every frame; the file is flushed after each frame, so it
+// can be read while the run goes on and survives a crash of the solver
+//
+// light data for all frames is the XDMF time series (timeSeries.cpp), which addresses
+// each frame as a hyperslab of /rho
+
+void writeMeshSeries(mesh_series &  series,
+                     const int      nn,
+                     const int      myid,
+                     const int      offset_x,   // global index of the first local node along X
+                     const int      offset_y,   // global index of the first local node along Y
+                     const int      offset_z,   // global index of the first local node along Z
+                     const int      LX,
+                     const int      LY,
+                     const int      LZ,
+                     const int      time,
+                     const double*  rho,
+                     output_codec & codec)      // dataset storage settings and statistics
+{
+    std::cout << "appending data to the output series for t = " << time << std::endl;
+
+    const long long GZ = nn + LZ + nn;          // planes of rho including ghost nodes
+    const long long SX = strideX(nn, LX);       // row stride of rho (may be padded)
+    const long long SY = strideY(nn, LX, LY);   // rows per plane of rho (may be padded)
+
+    hsize_t frame_dims[3] = {(hsize_t) LZ, (hsize_t) LY, (hsize_t) LX};
+
+    double t_beg = MPI_Wtime();
+
+    if(!series.open)
+    {
+        // for example: series_t_000000_mpi_002.h5 (named after the first frame, a restarted run starts a new file)
+
+        std::stringstream file_name;
+        file_name << "../out/hdf5/series_t_" << std::setw(6) << std::setfill('0') << time
+                  << "_mpi_" << std::setw(3) << std::setfill('0') << myid << ".h5";
+
+        series.file_id = H5Fcreate(file_name.str().c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+        series.dataset = outputCodecCreateSeries(codec, series.file_id, "/rho", frame_dims);
+
+        hsize_t dims[1] = {0}, maxdims[1] = {H5S_UNLIMITED}, chunk[1] = {64};
+        hid_t   timespace = H5Screate_simple(1, dims, maxdims);
+        hid_t   dcpl      = H5Pcreate(H5P_DATASET_CREATE);
+        H5Pset_chunk(dcpl, 1, chunk);
+        series.times = H5Dcreate2(series.file_id, "/time", H5T_STD_I32LE, timespace, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+        H5Pclose(dcpl);
+        H5Sclose(timespace);
+
+        // position of this block in the global NZ x NY x NX lattice (same Z, Y, X order as a frame)
+
+        int     offset[3] = {offset_z, offset_y, offset_x};
+        hsize_t dimsa[1]  = {3};
+        hid_t   attrspace = H5Screate_simple(1, dimsa, NULL);
+        hid_t   attribute = H5Acreate2(series.dataset, "global_offset", H5T_STD_I32LE, attrspace, H5P_DEFAULT, H5P_DEFAULT);
+        H5Awrite(attribute, H5T_NATIVE_INT, offset);
+        H5Aclose(attribute);
+        H5Sclose(attrspace);
+
+        // rho in memory: the LX x LY x LZ interior of a ghosted (and possibly padded) SX x SY x GZ array
+
+        hsize_t dimsm[3] = {(hsize_t) GZ, (hsize_t) SY, (hsize_t) SX};
+        hsize_t start[3] = {(hsize_t) nn, (hsize_t) nn, (hsize_t) nn};
+        series.memspace  = H5Screate_simple(3, dimsm, NULL);
+        H5Sselect_hyperslab(series.memspace, H5S_SELECT_SET, start, NULL, frame_dims, NULL);
+
+        series.packed_space = H5Screate_simple(3, frame_dims, NULL);
+
+        series.frames = 0;
+        series.stored = 0.;
+        series.open   = true;
+    }
+
+    // interior copy, only made if the values are quantized (or benchmarked) before writing
+
+    const double *packed = outputCodecPack(codec, rho, SX, SY, nn, LX, LY, LZ, myid);
+
+    // one more frame along the time axis
+
+    hsize_t dims[4]  = {series.frames + 1, frame_dims[0], frame_dims[1], frame_dims[2]};
+    hsize_t start[4] = {series.frames, 0, 0, 0};
+    hsize_t count[4] = {1, frame_dims[0], frame_dims[1], frame_dims[2]};
+    H5Dset_extent(series.dataset, dims);
+
+    hid_t filespace = H5Dget_space(series.dataset);
+    H5Sselect_hyperslab(filespace, H5S_SELECT_SET, start, NULL, count, NULL);
+    if(packed) H5Dwrite(series.dataset, H5T_NATIVE_DOUBLE, series.packed_space, filespace, H5P_DEFAULT, packed);
+    else       H5Dwrite(series.dataset, H5T_NATIVE_DOUBLE, series.memspace,     filespace, H5P_DEFAULT, rho);
+    H5Sclose(filespace);
+
+    hsize_t time_dims[1] = {series.frames + 1}, time_start[1] = {series.frames}, one[1] = {1};
+    H5Dset_extent(series.times, time_dims);
+    hid_t time_space = H5Dget_space(series.times);
+    hid_t time_mem   = H5Screate_simple(1, one, NULL);
+    H5Sselect_hyperslab(time_space, H5S_SELECT_SET, time_start, NULL, one, NULL);
+    H5Dwrite(series.times, H5T_NATIVE_INT, time_mem, time_space, H5P_DEFAULT, &time);
+    H5Sclose(time_mem);
+    H5Sclose(time_space);
+
+    H5Fflush(series.file_id, H5F_SCOPE_LOCAL);
+    series.frames++;
+
+    // the dataset holds all frames so far: only the growth counts for this one
+
+    double stored = (double) H5Dget_storage_size(series.dataset);
+    codec.datasets++;
+    codec.bytes_raw    += (double) LX*LY*LZ * sizeof(double);
+    codec.bytes_stored += stored - series.stored;
+    codec.time         += MPI_Wtime() - t_beg;
+    series.stored = stored;
+}
+
+// close the time-series file at the end of the run
+
+void writeMeshSeriesClose(mesh_series & series)
+{
+    if(!series.open) return;
+
+    H5Sclose(series.packed_space);
+    H5Sclose(series.memspace);
+    H5Dclose(series.times);
+    H5Dclose(series.dataset);
+    H5Fclose(series.file_id);
+    series.open = false;
+}
@@ -0,0 +1,175 @@
+#include "writeMesh.h"
+
+// this function writes one frame of all ranks to a single HDF5 file
+// rank 0 creates the file with a contiguous NZ x NY x NX dataset /rho whose storage is allocated
+// right away, and tells everybody where that storage starts in the file; all ranks then write the
+// interior of their rho buffer into their hyperslab of it collectively with MPI-IO, exactly like
+// the checkpoints (subarray file view, subarray memory type skipping ghost layers and padding)
+// rank 0 writes the XDMF file describing the global grid
+//
+// this works with any HDF5 build (no parallel HDF5 needed): HDF5 only ever touches the file on
+// rank 0, and raw data of a contiguous dataset is a plain array at a fixed address
+//
+// chunked (compressed) datasets cannot be written this way: with output_filter set, the frame is
+// written one file per rank instead
+
+void writeMeshShared(const int      nn,
+                     const MPI_Comm CART_COMM,
+                     const int      myid,
+                     const double   local_origin_x,
+                     const double   local_origin_y,
+                     const double   local_origin_z,
+                     const double   delta,
+                     const int      NX,         // global nodes along X
+                     const int      NY,         // global nodes along Y
+                     const int      NZ,         // global nodes along Z
+                     const int      offset_x,   // global index of the first local node along X
+                     const int      offset_y,   // global index of the first local node along Y
+                     const int      offset_z,   // global index of the first local node along Z
+                     const int      LX,
+                     const int      LY,
+                     const int      LZ,
+                     const int      time,
+                     const double*  rho,
+                     output_codec & codec)      // dataset storage settings and statistics
+{
+    if(codec.filter != OUTPUT_FILTER_NONE)
+    {
+        static bool warned = false;
+        if(myid == 0 && !warned)
+        {
+            std::cout << "compressed datasets cannot be written to a shared file: writing one output file per rank instead" << std::endl;
+            warned = true;
+        }
+
+        writeMesh(nn, CART_COMM, myid, local_origin_x, local_origin_y, local_origin_z, delta,
+                  offset_x, offset_y, offset_z, LX, LY, LZ, time, rho, codec);
+        return;
+    }
+
+    if(myid == 0) std::cout << "writing data to the shared output file for t = " << time << std::endl;
+
+    const long long GZ = nn + LZ + nn;          // planes of rho including ghost nodes
+    const long long SX = strideX(nn, LX);       // row stride of rho (may be padded)
+    const long long SY = strideY(nn, LX, LY);   // rows per plane of rho (may be padded)
+
+    // one file per frame, for example: data_t_000100.h5
+
+    std::stringstream file_name;
+    file_name << "t_" << std::setw(6) << std::setfill('0') << time;
+
+    std::string hdf5_file_with_path = "../out/hdf5/data_" + file_name.str() + ".h5";
+    std::string hdf5_file = "data_" + file_name.str() + ".h5";
+
+    // interior copy, only made if the values are quantized (or benchmarked) before writing
+
+    const double *packed = outputCodecPack(codec, rho, SX, SY, nn, LX, LY, LZ, myid);
+
+    double t_beg = MPI_Wtime();
+
+    // rank 0: file, global density field (little-endian doubles, Z slowest) and the address of its data
+
+    long long data_address = -1;
+    if(myid == 0)
+    {
+        hsize_t dimsf[3]  = {(hsize_t) NZ, (hsize_t) NY, (hsize_t) NX};
+        hid_t   file_id   = H5Fcreate(hdf5_file_with_path.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+        hid_t   dataspace = H5Screate_simple(3, dimsf, NULL);
+        hid_t   dcpl      = H5Pcreate(H5P_DATASET_CREATE);
+        H5Pset_layout(dcpl, H5D_CONTIGUOUS);
+        H5Pset_alloc_time(dcpl, H5D_ALLOC_TIME_EARLY);   // storage exists (and has an address) right away
+        H5Pset_fill_time(dcpl, H5D_FILL_TIME_NEVER);     // every value is written below
+        hid_t   dataset   = H5Dcreate2(file_id, "/rho", H5T_IEEE_F64LE, dataspace, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+
+        haddr_t address = H5Dget_offset(dataset);
+        if(dataset >= 0 && address != HADDR_UNDEF) data_address = (long long) address;
+
+        H5Pclose(dcpl);
+        H5Sclose(dataspace);
+        H5Dclose(dataset);
+        H5Fclose(file_id);
+    }
+
+    // (the broadcast also orders the MPI-IO open after rank 0 has closed the file)
+    MPI_Bcast(&data_address, 1, MPI_LONG_LONG, 0, CART_COMM);
+    if(data_address < 0)
+    {
+        if(myid == 0) std::cout << "ERROR: could not create " << hdf5_file_with_path << std::endl;
+        return;
+    }
+
+    // this rank's part of the file ...
+
+    int global_size[3] = {NZ, NY, NX};
+    int block_size[3]  = {LZ, LY, LX};
+    int file_start[3]  = {offset_z, offset_y, offset_x};
+
+    // ... comes from the interior of the (padded, ghosted) rho buffer, or from the quantized copy
+
+    int array_size[3]  = {(int) GZ, (int) SY, (int) SX};
+    int array_start[3] = {nn, nn, nn};
+    int packed_start[3] = {0, 0, 0};
+
+    MPI_Datatype file_block, array_block;
+    MPI_Type_create_subarray(3, global_size, block_size, file_start, MPI_ORDER_C, MPI_DOUBLE, &file_block);
+    if(packed) MPI_Type_create_subarray(3, block_size, block_size, packed_start, MPI_ORDER_C, MPI_DOUBLE, &array_block);
+    else       MPI_Type_create_subarray(3, array_size, block_size, array_start,  MPI_ORDER_C, MPI_DOUBLE, &array_block);
+    MPI_Type_commit(&file_block);
+    MPI_Type_commit(&array_block);
+
+    // all ranks write together
+
+    MPI_File fh;
+    int status = MPI_File_open(CART_COMM, hdf5_file_with_path.c_str(), MPI_MODE_WRONLY, MPI_INFO_NULL, &fh);
+    if(status == MPI_SUCCESS)
+    {
+        MPI_File_set_view(fh, (MPI_Offset) data_address, MPI_DOUBLE, file_block, "native", MPI_INFO_NULL);
+        status = MPI_File_write_all(fh, (void*) (packed ? packed : rho), 1, array_block, MPI_STATUS_IGNORE);
+        MPI_File_close(&fh);
+    }
+    if(status != MPI_SUCCESS) std::cout << "ERROR: rank " << myid << " could not write " << hdf5_file_with_path << std::endl;
+
+    MPI_Type_free(&file_block);
+    MPI_Type_free(&array_block);
+
+    // every rank accounts for its share of the dataset (stored uncompressed)
+
+    codec.datasets++;
+    codec.bytes_raw    += (double) LX*LY*LZ * sizeof(double);
+    codec.bytes_stored += (double) LX*LY*LZ * sizeof(double);
+    codec.time         += MPI_Wtime() - t_beg;
+
+    // XDMF file describing the global grid (light data)
+
+    if(myid != 0) return;
+
+    std::ofstream XDMF;
+    std::string xdmf_filename = "../out/xdmf/data_" + file_name.str() + ".xmf";
+    XDMF.open(xdmf_filename.c_str());
+
+    if(XDMF.fail())
+    {
+        std::cout << "ERROR: could not open file for writing XDMF output!" << std::endl;
+    }
+
+    XDMF << "    <Grid Name=\"mesh global\" GridType=\"Uniform\">\n";
+    XDMF << "        <Topology TopologyType=\"3DCoRectMesh\" Dimensions=\"" << NZ << " " << NY << " " << NX << "\" >\n";
+    XDMF << "        </Topology>\n";
+    XDMF << "        <Geometry GeometryType=\"ORIGIN_DXDYDZ\">\n";
+    XDMF << "            <DataItem Format=\"XML\" NumberType=\"Float\" Dimensions=\"3\">\n";
+    XDMF << "                " << local_origin_z - offset_z*delta << " " << local_origin_y - offset_y*delta
+         << " " << local_origin_x - offset_x*delta << "\n";
+    XDMF << "            </DataItem>\n";
+    XDMF << "            <DataItem Format=\"XML\" NumberType=\"Float\" Dimensions=\"3\">\n";
+    XDMF << "                " << delta << " " << delta << " " << delta << "\n";
+    XDMF << "            </DataItem>\n";
+    XDMF << "        </Geometry>\n";
+    XDMF << "        <Attribute Name=\"rho\" AttributeType=\"Scalar\" Center=\"Node\">\n";
+    XDMF << "            <DataItem Dimensions=\"" << NZ << " " << NY << " " << NX << "\" Precision=\" 8 \" Format=\"HDF\">\n";
+    XDMF << "                " << "./hdf5/" << hdf5_file << ":/rho\n";
+    XDMF << "            </DataItem>\n";
+    XDMF << "        </Attribute>\n";
+    XDMF << "    </Grid>\n";
+
+    XDMF.close();
+}